@@ -0,0 +1,11 @@
+#! /bin/sh
+
+set -e
+
+build()
+{
+	c++ --std=c++11 -O2 -Icpp cpp/ysl.cpp "$1.cpp" -o "/tmp/$1" -lglog -lyaml-cpp -lpthread -lrt
+}
+
+build bench_buffer && /tmp/bench_buffer
+build bench_format && /tmp/bench_format
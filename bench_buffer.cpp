@@ -0,0 +1,80 @@
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "ysl.hpp"
+
+// YSL_TO_BUFFER against YSL_TO_STRING on the same payload, time and allocations per payload
+
+static std::atomic<long> g_allocs{0};
+
+void* operator new(std::size_t size)
+{
+	++g_allocs;
+	if (auto ptr = std::malloc(size))
+	{
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+	std::free(ptr);
+}
+
+template <typename F>
+void bench(const char* name, int n, F&& payload)
+{
+	const auto allocs = g_allocs.load();
+	const auto start  = std::chrono::steady_clock::now();
+	for (int k = 0; k < n; ++k)
+	{
+		payload(k);
+	}
+	const auto stop = std::chrono::steady_clock::now();
+	std::printf("%-14s %8.0f ns/payload %6.1f allocs/payload\n", name,
+				std::chrono::duration<double, std::nano>(stop - start).count() / n,
+				static_cast<double>(g_allocs.load() - allocs) / n);
+}
+
+int main(int argc, char* argv[])
+{
+	FLAGS_logtostderr = true;
+
+	google::InitGoogleLogging(argv[0]);
+
+	const int n = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+	YSL::Buffer buffer(1024);
+	bench("YSL_TO_BUFFER", n, [&buffer](int k) {
+		YSL_TO_BUFFER(buffer) << YSL::BeginMap << "status"
+							  << "ok"
+							  << "id" << k << "x" << k * .5f << YSL::EndMap;
+		buffer.clear();
+	});
+
+	std::string message, payload;
+	bench("YSL_TO_STRING", n, [&message, &payload](int k) {
+		payload.clear();
+		YSL_TO_STRING(INFO, &message) << YSL::BeginMap;
+		payload += message;
+		YSL_TO_STRING(INFO, &message) << "status"
+									  << "ok"
+									  << "id" << k << "x" << k * .5f;
+		payload += message;
+		YSL_TO_STRING(INFO, &message) << YSL::EndMap << YSL::EndDoc;
+		payload += message;
+	});
+
+	return 0;
+}
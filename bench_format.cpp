@@ -0,0 +1,152 @@
+
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "stl_emitter.hpp"
+
+// streamable and complex emission with the reused per-thread formatting stream,
+// against a std::stringstream per value, time and allocations per value,
+// exits with 1 if the output is wrong or the reuse does not save allocations
+
+static std::atomic<long> g_allocs{0};
+
+void* operator new(std::size_t size)
+{
+	++g_allocs;
+	if (auto ptr = std::malloc(size))
+	{
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+	std::free(ptr);
+}
+
+struct Sticky // leaves std::fixed set
+{
+	double value;
+};
+
+struct Plain
+{
+	double value;
+};
+
+std::ostream& operator<<(std::ostream& stream, const Sticky& value)
+{
+	return stream << std::fixed << std::setprecision(2) << value.value;
+}
+
+std::ostream& operator<<(std::ostream& stream, const Plain& value)
+{
+	return stream << std::setprecision(17) << value.value;
+}
+
+// the emission before the formatting stream was reused
+template <typename T>
+YAML::Emitter& emit_fresh(YAML::Emitter& emitter, const T& value)
+{
+	std::stringstream ss;
+	ss << value;
+	return emitter << YAML::LocalTag(YAML::detail::typeid_name<T>()) << YAML::Literal << ss.str();
+}
+
+YAML::Emitter& emit_fresh(YAML::Emitter& emitter, const std::complex<double>& value)
+{
+	std::stringstream ss;
+	ss << value.real() << '+' << value.imag() << 'j';
+	return emitter << YAML::LocalTag("complex") << ss.str();
+}
+
+struct Result
+{
+	double ns;
+	double allocs;
+};
+
+template <typename F>
+Result bench(const char* name, int n, F&& emit)
+{
+	std::stringstream stream;
+	YAML::Emitter     emitter(stream);
+	emitter << YAML::Flow << YAML::BeginSeq;
+
+	const auto allocs = g_allocs.load();
+	const auto start  = std::chrono::steady_clock::now();
+	for (int k = 0; k < n; ++k)
+	{
+		emit(emitter, k);
+		if ((k & 1023) == 1023)
+		{
+			stream.str({}); // HINT: the output stream is not measured
+		}
+	}
+	const auto   stop = std::chrono::steady_clock::now();
+	const Result ret{std::chrono::duration<double, std::nano>(stop - start).count() / n,
+					 static_cast<double>(g_allocs.load() - allocs) / n};
+	std::printf("%-18s %8.0f ns/value %6.2f allocs/value\n", name, ret.ns, ret.allocs);
+	return ret;
+}
+
+template <typename T>
+std::string emit_one(const T& value)
+{
+	std::stringstream stream;
+	YAML::Emitter     emitter(stream);
+	emitter << YAML::Flow << YAML::BeginSeq << value << YAML::EndSeq;
+	return stream.str();
+}
+
+bool check(const std::string& name, const std::string& actual, const std::string& expected)
+{
+	if (actual.find(expected) != std::string::npos)
+	{
+		return true;
+	}
+	std::printf("FAILED %s: %s does not contain %s\n", name.c_str(), actual.c_str(),
+				expected.c_str());
+	return false;
+}
+
+int main(int argc, char* argv[])
+{
+	const int n = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+	bool ok = true;
+	ok &= check("sticky", emit_one(Sticky{1.5}), "1.50");
+	ok &= check("format reset", emit_one(Plain{0.25}), "\"0.25\"");
+	ok &= check("complex", emit_one(std::complex<double>{1.5, -2.}), "1.5+-2j");
+
+	// HINT: values are longer than the small string buffer
+	const auto fresh  = bench("streamable, fresh", n, [](YAML::Emitter& emitter, int k) {
+		emit_fresh(emitter, Plain{k * .1});
+	});
+	const auto reused = bench("streamable", n, [](YAML::Emitter& emitter, int k) {
+		emitter << Plain{k * .1};
+	});
+	const auto complex_fresh = bench("complex, fresh", n, [](YAML::Emitter& emitter, int k) {
+		emit_fresh(emitter, std::complex<double>{1e5 + k * .5, 1. / 3});
+	});
+	const auto complex_reused = bench("complex", n, [](YAML::Emitter& emitter, int k) {
+		emitter << std::complex<double>{1e5 + k * .5, 1. / 3};
+	});
+
+	ok &= reused.allocs < fresh.allocs && complex_reused.allocs < complex_fresh.allocs;
+	std::printf("%s\n", ok ? "OK" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -3,3 +3,4 @@
 set -x
 
 c++ --std=c++11 -O2 -g -Icpp cpp/ysl.cpp -lglog -lyaml-cpp -lpthread -shared -fPIC -Wall -Wl,-soname,libysl.so.0 -o libysl.so.0
+c++ --std=c++11 -O2 -g python/glog_scanner.cpp -shared -fPIC -Wall -o python/libglog_scanner.so
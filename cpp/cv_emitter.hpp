@@ -13,6 +13,80 @@
 namespace YAML
 {
 
+namespace detail
+{
+
+#ifdef YAML_DEF_EMIT_BINARY_TENSOR
+
+//// cv::Mat as binary tensor, false if not emitted
+
+inline bool cv_emit_binary_tensor(Emitter& emitter, const cv::Mat& value)
+{
+	const char* dtype = nullptr;
+	switch (value.depth())
+	{
+	case CV_8U:
+	{
+		dtype = "u1";
+		break;
+	}
+	case CV_8S:
+	{
+		dtype = "i1";
+		break;
+	}
+	case CV_16U:
+	{
+		dtype = "u2";
+		break;
+	}
+	case CV_16S:
+	{
+		dtype = "i2";
+		break;
+	}
+	case CV_32S:
+	{
+		dtype = "i4";
+		break;
+	}
+	case CV_32F:
+	{
+		dtype = "f4";
+		break;
+	}
+	case CV_64F:
+	{
+		dtype = "f8";
+		break;
+	}
+	default:
+	{
+		return false;
+	}
+	}
+
+	if (value.total() * value.channels() < YAML_DEF_EMIT_BINARY_TENSOR_MIN_SIZE)
+	{
+		return false;
+	}
+
+	std::vector<std::size_t> shape(value.size.p, value.size.p + value.dims);
+	if (value.channels() > 1)
+	{
+		shape.push_back(static_cast<std::size_t>(value.channels()));
+	}
+
+	const cv::Mat mat = value.isContinuous() ? value : value.clone();
+	emit_binary_tensor(emitter, dtype, shape, mat.data, mat.total() * mat.elemSize(),
+					   mat.elemSize1());
+	return true;
+}
+
+#endif
+
+} // namespace detail
+
 //// cv::String
 
 Emitter& operator<<(Emitter& emitter, const cv::String& value);
@@ -34,6 +108,15 @@ Emitter& operator<<(Emitter& emitter, const cv::MatExpr& value);
 template <typename T>
 Emitter& operator<<(Emitter& emitter, const cv::Mat_<T>& value)
 {
+#ifdef YAML_DEF_EMIT_BINARY_TENSOR
+
+	if (detail::cv_emit_binary_tensor(emitter, value))
+	{
+		return emitter;
+	}
+
+#endif
+
 	emitter << LocalTag("tensor");
 
 #ifndef YAML_DEF_EMIT_WITHOUT_CV_FORMATTER
@@ -186,6 +269,15 @@ inline Emitter& operator<<(Emitter& emitter, const cv::String& value)
 
 inline Emitter& operator<<(Emitter& emitter, const cv::Mat& value)
 {
+#ifdef YAML_DEF_EMIT_BINARY_TENSOR
+
+	if (detail::cv_emit_binary_tensor(emitter, value))
+	{
+		return emitter;
+	}
+
+#endif
+
 	auto formatter = cv::Formatter::get(cv::Formatter::FMT_PYTHON);
 	formatter->setMultiline(true);
 
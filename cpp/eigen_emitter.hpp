@@ -3,18 +3,64 @@
 
 #include <Eigen/Core>
 
-#include "emitter_extra.hpp"
-
 //// define YAML_DEF_EMIT_WITH_EIGEN_FORMATTER to enable Eigen formatter
 ////   see @ref https://eigen.tuxfamily.org/dox/structEigen_1_1IOFormat.html
+//// define YAML_DEF_EMIT_NO_EIGEN_SPARSE to disable Eigen sparse emission(and <Eigen/SparseCore>)
+////   sparse objects are emitted as !sparse:csr(row-major) or !sparse:csc(column-major) mapping
+////   of shape, nnz, dtype(if arithmetic), indptr, indices and data from the compressed storage
+////   without densifying, or !sparse:coo mapping with row and col instead if uncompressed
 
 // #define YAML_DEF_EMIT_WITH_EIGEN_FORMATTER
+// #define YAML_DEF_EMIT_NO_EIGEN_SPARSE
+
+#ifndef YAML_DEF_EMIT_NO_EIGEN_SPARSE
+
+#include <Eigen/SparseCore>
+
+#endif
+
+#include "emitter_extra.hpp"
 
 namespace YAML
 {
 namespace detail
 {
 
+//// Eigen dense object as binary tensor, false if not emitted
+
+template <typename T>
+inline enable_if_t<!tensor_dtype<typename T::Scalar>::value, bool>
+eigen_emit_binary_tensor(Emitter& /*emitter*/, const T& /*value*/)
+{
+	return false;
+}
+
+template <typename T>
+inline enable_if_t<tensor_dtype<typename T::Scalar>::value, bool>
+eigen_emit_binary_tensor(Emitter& emitter, const T& value)
+{
+	if (value.size() < YAML_DEF_EMIT_BINARY_TENSOR_MIN_SIZE)
+	{
+		return false;
+	}
+
+	using Scalar = typename T::Scalar;
+
+	const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> matrix = value;
+
+	std::vector<std::size_t> shape;
+	if (matrix.rows() > 1 && matrix.cols() > 1) // simplify vector representation
+	{
+		shape = {static_cast<std::size_t>(matrix.rows()), static_cast<std::size_t>(matrix.cols())};
+	}
+	else
+	{
+		shape = {static_cast<std::size_t>(matrix.size())};
+	}
+	emit_binary_tensor(emitter, matrix.data(), shape);
+	return true;
+}
+
 //// Eigen::DenseCoeffsBase(readonly)
 
 template <typename T>
@@ -24,10 +70,19 @@ struct generic_emitter<T, 4,
 {
 	inline static Emitter& emit(Emitter& emitter, const T& value)
 	{
+#ifdef YAML_DEF_EMIT_BINARY_TENSOR
+
+		if (eigen_emit_binary_tensor(emitter, value))
+		{
+			return emitter;
+		}
+
+#endif
+
 #ifdef YAML_DEF_EMIT_WITH_EIGEN_FORMATTER
 
-		Eigen::IOFormat   format(Eigen::StreamPrecision, 0, ", ", "\n", "[", "]");
-		std::stringstream ss;
+		Eigen::IOFormat format(Eigen::StreamPrecision, 0, ", ", "\n", "[", "]");
+		auto&           ss = detail::thread_format_stream();
 
 #ifdef YSL_NAMESPACE // extension
 
@@ -67,5 +122,151 @@ struct generic_emitter<T, 4,
 	}
 };
 
+#ifndef YAML_DEF_EMIT_NO_EIGEN_SPARSE
+
+//// Eigen sparse object arrays as flow sequence or binary tensor
+
+template <typename T>
+inline Emitter& eigen_emit_flow_array(Emitter& emitter, const T* data, std::size_t size)
+{
+	emitter << Flow << BeginSeq;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		emitter << detail::as_numeric(data[i]);
+	}
+	return emitter << EndSeq;
+}
+
+template <typename T>
+inline enable_if_t<!tensor_dtype<T>::value, Emitter&>
+eigen_emit_sparse_array(Emitter& emitter, const T* data, std::size_t size)
+{
+	return eigen_emit_flow_array(emitter, data, size);
+}
+
+template <typename T>
+inline enable_if_t<tensor_dtype<T>::value, Emitter&>
+eigen_emit_sparse_array(Emitter& emitter, const T* data, std::size_t size)
+{
+#ifdef YAML_DEF_EMIT_BINARY_TENSOR
+
+	if (size >= YAML_DEF_EMIT_BINARY_TENSOR_MIN_SIZE)
+	{
+		return emit_binary_tensor(emitter, data, {size});
+	}
+
+#endif
+
+	return eigen_emit_flow_array(emitter, data, size);
+}
+
+// open the mapping of tag sparse:`format` with shape, nnz and dtype
+template <typename T>
+inline Emitter& eigen_emit_sparse_header(Emitter& emitter, const char* format, const T& value,
+										 std::size_t nnz)
+{
+	using Scalar = typename T::Scalar;
+
+	emitter << LocalTag(std::string("sparse:").append(format)) << BeginMap;
+	emitter << Key << "shape" << Value << Flow << BeginSeq << value.rows() << value.cols()
+			<< EndSeq;
+	emitter << Key << "nnz" << Value << nnz;
+	if (tensor_dtype<Scalar>::value) // HINT: values in text may look like integers
+	{
+		emitter << Key << "dtype" << Value << tensor_dtype_name<Scalar>();
+	}
+	return emitter;
+}
+
+//// Eigen sparse object with compressed storage(SparseMatrix, SparseVector, Map, Ref)
+
+template <typename T>
+inline Emitter& eigen_emit_sparse(Emitter& emitter, const Eigen::SparseCompressedBase<T>& value)
+{
+	using StorageIndex = typename T::StorageIndex;
+
+	const auto& derived = value.derived();
+	const auto  outer   = static_cast<std::size_t>(derived.outerSize());
+	const auto  nnz     = static_cast<std::size_t>(derived.nonZeros());
+
+	if (derived.isCompressed())
+	{
+		// HINT: SparseVector has no outer index array, its single outer vector holds all nnz
+		std::vector<StorageIndex> rebased;
+		auto                      indptr = derived.outerIndexPtr();
+		if (indptr == nullptr)
+		{
+			rebased = {0, static_cast<StorageIndex>(nnz)};
+			indptr  = rebased.data();
+		}
+
+		// HINT: storage of an inner panel block starts at the offset in its parent
+		const auto offset = indptr[0];
+		if (offset != 0)
+		{
+			rebased.assign(indptr, indptr + outer + 1);
+			for (auto& index : rebased)
+			{
+				index -= offset;
+			}
+			indptr = rebased.data();
+		}
+
+		eigen_emit_sparse_header(emitter, T::IsRowMajor ? "csr" : "csc", derived, nnz);
+		emitter << Key << "indptr" << Value;
+		eigen_emit_sparse_array(emitter, indptr, outer + 1);
+		emitter << Key << "indices" << Value;
+		eigen_emit_sparse_array(emitter, derived.innerIndexPtr() + offset, nnz);
+		emitter << Key << "data" << Value;
+		eigen_emit_sparse_array(emitter, derived.valuePtr() + offset, nnz);
+		return emitter << EndMap;
+	}
+
+	std::vector<StorageIndex>       rows, cols;
+	std::vector<typename T::Scalar> data;
+	rows.reserve(nnz);
+	cols.reserve(nnz);
+	data.reserve(nnz);
+	for (std::size_t k = 0; k < outer; ++k)
+	{
+		for (typename T::InnerIterator it(derived, static_cast<Eigen::Index>(k)); it; ++it)
+		{
+			rows.push_back(static_cast<StorageIndex>(it.row()));
+			cols.push_back(static_cast<StorageIndex>(it.col()));
+			data.push_back(it.value());
+		}
+	}
+
+	eigen_emit_sparse_header(emitter, "coo", derived, data.size());
+	emitter << Key << "row" << Value;
+	eigen_emit_sparse_array(emitter, rows.data(), rows.size());
+	emitter << Key << "col" << Value;
+	eigen_emit_sparse_array(emitter, cols.data(), cols.size());
+	emitter << Key << "data" << Value;
+	eigen_emit_sparse_array(emitter, data.data(), data.size());
+	return emitter << EndMap;
+}
+
+// sparse expressions are evaluated into SparseMatrix, still without densifying
+template <typename T>
+inline Emitter& eigen_emit_sparse(Emitter& emitter, const Eigen::SparseMatrixBase<T>& value)
+{
+	const typename T::PlainObject matrix = value.derived();
+	return eigen_emit_sparse(emitter, matrix);
+}
+
+//// Eigen::SparseMatrixBase
+
+template <typename T>
+struct generic_emitter<T, 4, enable_if_t<std::is_base_of<Eigen::SparseMatrixBase<T>, T>::value>>
+{
+	inline static Emitter& emit(Emitter& emitter, const T& value)
+	{
+		return eigen_emit_sparse(emitter, value);
+	}
+};
+
+#endif
+
 } // namespace detail
 } // namespace YAML
@@ -6,17 +6,32 @@ Copyright (c) 2019 Macrobull
 
 #pragma once
 
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <cstring>
 #include <sstream>
+#include <string>
 #include <tuple>
 #include <typeinfo>
 #include <utility>
+#include <vector>
 
 //// define YAML_DEF_EMIT_NO_COMPLEX to emit complex numbers as sequence
 //// define YAML_DEF_EMIT_ENABLE_GENERAL_DEMANGLED_TAG to enable general demangled tag
 ////   currently for GCC only
+//// define YAML_DEF_EMIT_BINARY_TENSOR to emit tensors of cv::Mat, Eigen dense objects and
+////   contiguous arithmetic STL containers as !tensor:<dtype>:<shape> tagged base64 literal
+////   of raw little-endian data, e.g. !tensor:f4:3x4,
+////   tensors with fewer than YAML_DEF_EMIT_BINARY_TENSOR_MIN_SIZE elements are kept as text
 
 // #define YAML_DEF_EMIT_NO_COMPLEX
 // #define YAML_DEF_EMIT_ENABLE_GENERAL_DEMANGLED_TAG
+// #define YAML_DEF_EMIT_BINARY_TENSOR
+
+#ifndef YAML_DEF_EMIT_BINARY_TENSOR_MIN_SIZE
+#define YAML_DEF_EMIT_BINARY_TENSOR_MIN_SIZE 16
+#endif
 
 #if defined(YAML_DEF_EMIT_ENABLE_GENERAL_DEMANGLED_TAG) && defined(__GNUG__)
 
@@ -135,28 +150,91 @@ inline E& emit_mapping(E& emitter, T&& value)
 	return emitter << EndMap;
 }
 
+// formatting stream writing into a reusable string,
+// a std::stringstream for Emitter::SetStreamablePrecision
+class FormatStream : public std::stringstream
+{
+	class StringStreamBuf : public std::streambuf
+	{
+	public:
+		explicit StringStreamBuf(std::string& data) noexcept
+			: m_data(data)
+		{}
+
+	protected:
+		inline int overflow(int c) override
+		{
+			m_data.push_back(static_cast<char>(c));
+			return c;
+		}
+
+		inline std::streamsize xsputn(const char* s, std::streamsize n) override
+		{
+			m_data.append(s, static_cast<std::size_t>(n));
+			return n;
+		}
+
+	private:
+		std::string& m_data;
+	};
+
+public:
+	FormatStream()
+		: m_streambuf(m_data)
+	{
+		std::ios::rdbuf(&m_streambuf);
+	}
+
+	FormatStream(const FormatStream&) = delete;
+
+	FormatStream& operator=(const FormatStream&) = delete;
+
+	// clear the content and restore the default format, the storage is kept
+	inline FormatStream& reset()
+	{
+		m_data.clear();
+		clear();
+		flags(std::ios_base::skipws | std::ios_base::dec);
+		precision(6);
+		width(0);
+		fill(widen(' '));
+		return *this;
+	}
+
+	// formatted content, valid until the next reset
+	inline const std::string& str() const noexcept
+	{
+		return m_data;
+	}
+
+private:
+	std::string     m_data;
+	StringStreamBuf m_streambuf;
+};
+
+// reset per-thread formatting stream, to be used for one value at a time
+inline FormatStream& thread_format_stream()
+{
+	static thread_local FormatStream ret{};
+	return ret.reset();
+}
+
 template <typename T>
-inline Emitter&
-emit_streamable(Emitter& emitter, T&& value, std::stringstream* stream = nullptr)
+inline Emitter& emit_streamable(Emitter& emitter, T&& value, FormatStream* stream = nullptr)
 {
-	std::stringstream stream_;
 	if (stream == nullptr)
 	{
+		stream = &thread_format_stream();
+
 #ifdef YSL_NAMESPACE // extension
 
-		emitter.SetStreamablePrecision<T>(stream_);
+		emitter.SetStreamablePrecision<decay_t<T>>(*stream);
 
 #endif
-
-		stream = &stream_;
-	}
-	else
-	{
-		stream->str("");
 	}
 
 	*stream << value;
-	return emitter << stream->str();
+	return emitter << stream->str(); // HINT: written without copy
 }
 
 template <typename T>
@@ -164,11 +242,11 @@ inline Emitter& emit_complex(Emitter& emitter, T&& real, T&& imag)
 {
 #ifndef YAML_DEF_EMIT_NO_COMPLEX
 
-	std::stringstream ss;
+	auto& ss = thread_format_stream();
 
 #ifdef YSL_NAMESPACE // extension
 
-	emitter.SetStreamablePrecision<T>(ss);
+	emitter.SetStreamablePrecision<decay_t<T>>(ss);
 
 #endif
 
@@ -205,6 +283,153 @@ inline std::string typeid_name()
 	return name;
 }
 
+//// binary tensor
+
+// numpy style dtype of tensor element, e.g. f4, u1, c8
+template <typename T, typename Test = void>
+struct tensor_dtype : std::false_type
+{};
+
+template <typename T>
+struct tensor_dtype<T, enable_if_t<std::is_arithmetic<T>::value && sizeof(T) <= 8>>
+	: std::true_type
+{
+	using word_type = T; // byte order unit
+
+	inline static std::string name()
+	{
+		const auto kind = std::is_same<T, bool>::value
+								  ? 'b'
+								  : std::is_floating_point<T>::value
+											? 'f'
+											: std::is_signed<T>::value ? 'i' : 'u';
+		return kind + std::to_string(sizeof(T));
+	}
+};
+
+template <typename T>
+struct tensor_dtype<std::complex<T>, enable_if_t<std::is_floating_point<T>::value && sizeof(T) <= 8>>
+	: std::true_type
+{
+	using word_type = T;
+
+	inline static std::string name()
+	{
+		return 'c' + std::to_string(sizeof(std::complex<T>));
+	}
+};
+
+// dtype name of tensor element, empty if not a tensor element
+template <typename T>
+inline enable_if_t<tensor_dtype<T>::value, std::string> tensor_dtype_name()
+{
+	return tensor_dtype<T>::name();
+}
+
+template <typename T>
+inline enable_if_t<!tensor_dtype<T>::value, std::string> tensor_dtype_name()
+{
+	return {};
+}
+
+inline bool is_little_endian()
+{
+	const std::uint16_t probe = 1;
+	unsigned char       first{};
+	std::memcpy(&first, &probe, 1);
+	return first == 1;
+}
+
+// base64 of `size` bytes of `data` as little-endian words of `word_size`,
+// a newline is inserted every `line_width` (multiple of 4) characters
+inline std::string encode_base64(const void* data, std::size_t size, std::size_t word_size = 1,
+								 std::size_t line_width = 76)
+{
+	static const char table[] =
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	auto                       bytes = static_cast<const unsigned char*>(data);
+	std::vector<unsigned char> swapped;
+	if (word_size > 1 && !is_little_endian())
+	{
+		swapped.assign(bytes, bytes + size);
+		for (std::size_t i = 0; i + word_size <= size; i += word_size)
+		{
+			std::reverse(swapped.begin() + i, swapped.begin() + i + word_size);
+		}
+		bytes = swapped.data();
+	}
+
+	const std::size_t length = (size + 2) / 3 * 4;
+	std::string       ret(length + (length > 0 ? (length - 1) / line_width : 0), '\n');
+	auto              out    = &ret[0];
+	std::size_t       column = 0;
+	std::size_t       i      = 0;
+	for (; i + 3 <= size; i += 3)
+	{
+		if (column == line_width)
+		{
+			++out; // keep '\n'
+			column = 0;
+		}
+
+		const std::uint32_t word = static_cast<std::uint32_t>(bytes[i]) << 16 |
+								   static_cast<std::uint32_t>(bytes[i + 1]) << 8 | bytes[i + 2];
+		out[0] = table[word >> 18];
+		out[1] = table[(word >> 12) & 0x3f];
+		out[2] = table[(word >> 6) & 0x3f];
+		out[3] = table[word & 0x3f];
+		out += 4;
+		column += 4;
+	}
+	if (i < size)
+	{
+		if (column == line_width)
+		{
+			++out;
+		}
+
+		const std::uint32_t word = static_cast<std::uint32_t>(bytes[i]) << 16 |
+								   (i + 1 < size ? static_cast<std::uint32_t>(bytes[i + 1]) << 8 : 0);
+		out[0] = table[word >> 18];
+		out[1] = table[(word >> 12) & 0x3f];
+		out[2] = i + 1 < size ? table[(word >> 6) & 0x3f] : '=';
+		out[3] = '=';
+	}
+	return ret;
+}
+
+inline Emitter& emit_binary_tensor(Emitter& emitter, const std::string& dtype,
+								   const std::vector<std::size_t>& shape, const void* data,
+								   std::size_t size, std::size_t word_size)
+{
+	std::string tag("tensor:");
+	tag.append(dtype).push_back(':');
+	for (std::size_t i = 0; i < shape.size(); ++i)
+	{
+		if (i > 0)
+		{
+			tag.push_back('x');
+		}
+		tag.append(std::to_string(shape[i]));
+	}
+	return emitter << LocalTag(tag) << Literal << encode_base64(data, size, word_size);
+}
+
+// emit row-major `data` of `shape` as binary tensor
+template <typename T>
+inline Emitter&
+emit_binary_tensor(Emitter& emitter, const T* data, const std::vector<std::size_t>& shape)
+{
+	std::size_t count = 1;
+	for (const auto dim : shape)
+	{
+		count *= dim;
+	}
+	return emit_binary_tensor(emitter, tensor_dtype<T>::name(), shape, data, count * sizeof(T),
+							  sizeof(typename tensor_dtype<T>::word_type));
+}
+
 //// ranked generic emit implementation
 
 template <typename T, size_t R, typename Test = void>
@@ -0,0 +1,403 @@
+/*
+
+Copyright (c) 2026 agent
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ysl.hpp"
+
+//// shared memory sink configs
+
+#ifndef YSL_SHM_SINK_CAPACITY // default data bytes of the shared memory ring
+
+#define YSL_SHM_SINK_CAPACITY (std::size_t{1} << 24)
+
+#endif
+
+//// shared memory layout, see SharedMemoryRing in python/backends.py
+////   header(64 bytes): magic "YSLSHM01", capacity, write position, read position, dropped,
+////     writer epoch(changed as the ring is reset)
+////   data(capacity bytes): records aligned to 8 bytes, positions are monotonic byte counts
+////   record header(40 bytes): size(including header and padding), kind, thread id, name size,
+////     frame index, time in us, text size, context id(low 32 bits, 0 if not written through a
+////     YSL::Context), then the name and the text
+////   a record never wraps, the tail is skipped by a padding record, or implicitly if it is
+////   shorter than a record header
+
+namespace YSL_NS
+{
+
+// glog sink publishing complete YSL documents to a named POSIX shared memory ring,
+// for live visualization without the log file, file logging keeps running in parallel
+// messages are reassembled into documents per thread, or per YSL::Context for its records,
+// a document is published with its frame name and index as the next document of the thread
+// starts or on EndDoc('...'), or at the end of a context record not continued
+// the writer never blocks, documents are dropped and counted if the reader falls behind
+//   usage: YSL::SharedMemorySink sink("ysl"); google::AddLogSink(&sink);
+class SharedMemorySink : public google::LogSink
+{
+public:
+	static constexpr std::uint32_t kind_document = 0;
+	static constexpr std::uint32_t kind_padding  = 1;
+	static constexpr std::int64_t  no_index      = INT64_MIN; // frame index of None
+
+	static constexpr std::size_t header_size = 64;
+	static constexpr std::size_t record_size = 40;
+
+	// create or reset the ring `name`(shm_open name, '/' is prepended if missing),
+	// the ring is kept after destruction unless `unlink`
+	explicit SharedMemorySink(std::string rv_name,
+							  std::size_t capacity = YSL_SHM_SINK_CAPACITY, bool unlink = false)
+		: m_name(rv_name.empty() || rv_name[0] != '/' ? "/" + rv_name : std::move(rv_name))
+		, m_serial(next_serial())
+		, m_capacity((capacity + 7) & ~std::size_t{7})
+		, m_unlink(unlink)
+	{
+		const int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+		if (fd < 0)
+		{
+			LOG(ERROR) << "shm_open failed for " << m_name;
+			return;
+		}
+
+		const auto size = header_size + m_capacity;
+		if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+		{
+			auto addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (addr != MAP_FAILED)
+			{
+				m_base = static_cast<char*>(addr);
+			}
+		}
+		close(fd);
+		if (m_base == nullptr)
+		{
+			LOG(ERROR) << "failed to map " << size << " bytes of " << m_name;
+			return;
+		}
+
+		// HINT: a reader of the previous ring restarts as the epoch changes
+		const std::uint64_t epoch =
+				(static_cast<std::uint64_t>(getpid()) << 32) ^
+				static_cast<std::uint64_t>(
+						std::chrono::steady_clock::now().time_since_epoch().count());
+		std::memset(m_base + 8, 0, header_size - 8);
+		std::memcpy(m_base + 8, &m_capacity, sizeof(std::uint64_t));
+		std::memcpy(m_base + 40, &epoch, sizeof(std::uint64_t));
+		std::memcpy(m_base, "YSLSHM01", 8);
+		write_pos().store(0, std::memory_order_release);
+	}
+
+	~SharedMemorySink() override
+	{
+		if (m_base != nullptr)
+		{
+			munmap(m_base, header_size + m_capacity);
+			if (m_unlink)
+			{
+				shm_unlink(m_name.c_str());
+			}
+		}
+	}
+
+	SharedMemorySink(const SharedMemorySink&) = delete;
+
+	SharedMemorySink& operator=(const SharedMemorySink&) = delete;
+
+	inline const std::string& name() const noexcept
+	{
+		return m_name;
+	}
+
+	inline bool is_open() const noexcept
+	{
+		return m_base != nullptr;
+	}
+
+	// number of documents dropped as the ring is full
+	inline std::uint64_t dropped() const noexcept
+	{
+		return m_base != nullptr ? dropped_count().load(std::memory_order_relaxed) : 0;
+	}
+
+	// google::LogSink, called in the logging thread
+	void send(google::LogSeverity /*severity*/, const char* /*full_filename*/,
+			  const char* /*base_filename*/, int /*line*/, const struct ::tm* /*tm_time*/,
+			  const char* message, std::size_t message_len) override
+	{
+		if (m_base == nullptr)
+		{
+			return;
+		}
+
+		static const char context_prefix[] = "# YSL::Context ";
+		constexpr auto    prefix_len       = sizeof(context_prefix) - 1;
+		if (message_len >= prefix_len && std::memcmp(message, context_prefix, prefix_len) == 0)
+		{
+			send_context(message + prefix_len, message_len - prefix_len);
+			return;
+		}
+
+		append(thread_document(), message, message_len);
+	}
+
+	// publish the pending document of the calling thread, e.g. before the thread exits
+	void flush()
+	{
+		if (m_base != nullptr)
+		{
+			publish(thread_document());
+		}
+	}
+
+private:
+	struct PendingDocument
+	{
+		std::uint64_t serial;
+		std::string   name;
+		std::int64_t  index;
+		std::int64_t  time_us;
+		std::string   text;
+		std::uint64_t context; // id of YSL::Context, 0 for the thread
+	};
+
+	static std::uint64_t next_serial()
+	{
+		static std::atomic<std::uint64_t> serial{0};
+		return ++serial;
+	}
+
+	// append a message line to `document`
+	void append(PendingDocument& document, const char* message, std::size_t message_len)
+	{
+		if (is_document_start(message, message_len))
+		{
+			publish(document);
+			parse_frame(document, message, message_len);
+		}
+		else if (document.text.empty())
+		{
+			document.name.clear();
+			document.index = -1; // HINT: same as FrameParser for text before any frame
+		}
+		if (document.text.empty())
+		{
+			document.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+									   std::chrono::system_clock::now().time_since_epoch())
+									   .count();
+		}
+
+		document.text.append(message, message_len).push_back('\n');
+		if (message_len >= 3 && std::memcmp(message, "...", 3) == 0 &&
+			(message_len == 3 || message[3] == ' '))
+		{
+			publish(document);
+		}
+	}
+
+	// lines of a context record "<id>[ +]\n<text>", see YSL::Context
+	void send_context(const char* message, std::size_t message_len)
+	{
+		std::uint64_t id  = 0;
+		std::size_t   pos = 0;
+		while (pos < message_len && message[pos] >= '0' && message[pos] <= '9')
+		{
+			id = id * 10 + static_cast<std::uint64_t>(message[pos++] - '0');
+		}
+		const bool continued = message_len - pos >= 2 && message[pos] == ' ' &&
+							   message[pos + 1] == '+';
+
+		std::lock_guard<std::mutex> lock(m_context_mutex);
+
+		auto it = m_contexts.find(id);
+		if (it == m_contexts.end())
+		{
+			it = m_contexts.emplace(id, PendingDocument{m_serial, {}, -1, 0, {}, id}).first;
+		}
+
+		auto line = static_cast<const char*>(std::memchr(message, '\n', message_len));
+		auto last = message + message_len;
+		while (line != nullptr && ++line < last)
+		{
+			auto end = static_cast<const char*>(std::memchr(line, '\n', last - line));
+			append(it->second, line, (end != nullptr ? end : last) - line);
+			line = end;
+		}
+		if (!continued)
+		{
+			publish(it->second);
+			m_contexts.erase(it);
+		}
+	}
+
+	static bool is_document_start(const char* message, std::size_t message_len)
+	{
+		return message_len >= 3 && std::memcmp(message, "---", 3) == 0 &&
+			   (message_len == 3 || message[3] == ' ');
+	}
+
+	// frame name and index from "--- # ---- name: index ---- # ---", see FrameParser
+	static void parse_frame(PendingDocument& document, const char* message,
+							std::size_t message_len)
+	{
+		document.name.clear();
+		document.index = -1;
+
+		static const char prefix[] = "--- #";
+		static const char suffix[] = "# ---";
+		constexpr auto    fix_len  = sizeof(prefix) - 1;
+		if (message_len < fix_len * 2 || std::memcmp(message, prefix, fix_len) != 0 ||
+			std::memcmp(message + message_len - fix_len, suffix, fix_len) != 0)
+		{
+			return;
+		}
+
+		auto first = message + fix_len;
+		auto last  = message + message_len - fix_len;
+		while (first < last && (*first == ' ' || *first == '-'))
+		{
+			++first;
+		}
+		while (first < last && (last[-1] == ' ' || last[-1] == '-'))
+		{
+			--last;
+		}
+
+		document.name.assign(first, last);
+		const auto pos = document.name.find(": ");
+		if (pos == std::string::npos)
+		{
+			document.index = no_index;
+			return;
+		}
+
+		document.index = std::strtoll(document.name.c_str() + pos + 2, nullptr, 10);
+		document.name.resize(pos);
+	}
+
+	PendingDocument& thread_document()
+	{
+		static thread_local std::vector<PendingDocument> documents;
+
+		for (auto& document : documents)
+		{
+			if (document.serial == m_serial)
+			{
+				return document;
+			}
+		}
+		documents.push_back(PendingDocument{m_serial, {}, -1, 0, {}, 0});
+		return documents.back();
+	}
+
+	static std::uint32_t thread_id()
+	{
+		static thread_local const auto tid = static_cast<std::uint32_t>(syscall(SYS_gettid));
+		return tid;
+	}
+
+	std::atomic<std::uint64_t>& write_pos() const noexcept
+	{
+		return *reinterpret_cast<std::atomic<std::uint64_t>*>(m_base + 16);
+	}
+
+	std::atomic<std::uint64_t>& read_pos() const noexcept
+	{
+		return *reinterpret_cast<std::atomic<std::uint64_t>*>(m_base + 24);
+	}
+
+	std::atomic<std::uint64_t>& dropped_count() const noexcept
+	{
+		return *reinterpret_cast<std::atomic<std::uint64_t>*>(m_base + 32);
+	}
+
+	// write the record at `offset` of data
+	void write_record(std::size_t offset, std::uint32_t size, std::uint32_t kind,
+					  const PendingDocument* document)
+	{
+		const std::uint32_t name_size = document ? document->name.size() : 0;
+		const std::uint32_t text_size = document ? document->text.size() : 0;
+		const std::uint32_t context =
+				document ? static_cast<std::uint32_t>(document->context) : 0; // low 32 bits
+		const std::uint32_t head[]    = {size, kind, document ? thread_id() : 0, name_size};
+		const std::int64_t  meta[]    = {document ? document->index : 0,
+										 document ? document->time_us : 0};
+		const std::uint32_t tail[]    = {text_size, context};
+
+		auto data = m_base + header_size + offset;
+		std::memcpy(data, head, sizeof(head));
+		std::memcpy(data + sizeof(head), meta, sizeof(meta));
+		std::memcpy(data + sizeof(head) + sizeof(meta), tail, sizeof(tail));
+		if (document != nullptr)
+		{
+			std::memcpy(data + record_size, document->name.data(), name_size);
+			std::memcpy(data + record_size + name_size, document->text.data(), text_size);
+		}
+	}
+
+	void publish(PendingDocument& document)
+	{
+		if (document.text.empty())
+		{
+			return;
+		}
+
+		const auto size = (record_size + document.name.size() + document.text.size() + 7) &
+						  ~std::size_t{7};
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto       write  = write_pos().load(std::memory_order_relaxed);
+		const auto read   = read_pos().load(std::memory_order_acquire);
+		const auto offset = static_cast<std::size_t>(write % m_capacity);
+		const auto tail   = m_capacity - offset;
+		const auto pad    = tail < size ? tail : 0;
+		if (size > m_capacity || write + pad + size - read > m_capacity)
+		{
+			dropped_count().fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			if (pad >= record_size)
+			{
+				write_record(offset, static_cast<std::uint32_t>(pad), kind_padding, nullptr);
+			}
+			write += pad;
+			write_record(static_cast<std::size_t>(write % m_capacity),
+						 static_cast<std::uint32_t>(size), kind_document, &document);
+			write_pos().store(write + size, std::memory_order_release);
+		}
+		document.text.clear();
+	}
+
+	const std::string   m_name;
+	const std::uint64_t m_serial; // HINT: keys thread-local documents, as addresses are reused
+	const std::size_t   m_capacity;
+	const bool          m_unlink;
+	char*               m_base{nullptr};
+	std::mutex          m_mutex;
+	// pending documents of continued context records by id
+	std::mutex                                          m_context_mutex;
+	std::unordered_map<std::uint64_t, PendingDocument> m_contexts;
+};
+
+} // namespace YSL_NS
@@ -67,6 +67,15 @@ public:
 		return *m_pointer;
 	}
 
+	// construct by `constructor`.construct(T&) on the storage, see @ref ReconstructorBase
+	template <typename C>
+	inline T& construct_by(const C& constructor)
+	{
+		try_destruct();
+		m_pointer = std::addressof(constructor.construct(*reinterpret_cast<T*>(m_storage)));
+		return *m_pointer;
+	}
+
 	inline bool try_destruct() noexcept
 	{
 		if (m_pointer != nullptr)
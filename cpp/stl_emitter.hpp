@@ -34,6 +34,7 @@ using stl_is_std_iterable = std::is_same<decltype(std::begin(std::declval<T>()))
 
 TRAITS_DECL_CLASS_HAS_TYPE(element_type)
 TRAITS_DECL_CLASS_HAS_TYPE(mapped_type)
+TRAITS_DECL_CLASS_HAS_TYPE(traits_type)
 
 #undef TRAITS_DECL_CLASS_HAS_TYPE
 
@@ -49,6 +50,39 @@ struct generic_emitter<T, 2, enable_if_t<detail::stl_is_std_iterable<T>::value>>
 	}
 };
 
+//// std::array, std::vector of arithmetic types as binary tensor
+
+#ifdef YAML_DEF_EMIT_BINARY_TENSOR
+
+template <class T, typename Test = void>
+struct stl_is_contiguous_tensor : std::false_type
+{};
+
+template <class T>
+struct stl_is_contiguous_tensor<T, void_t<decltype(std::declval<const T&>().data()),
+										  decltype(std::declval<const T&>().size()),
+										  typename T::value_type>>
+	: std::integral_constant<bool, detail::tensor_dtype<typename T::value_type>::value &&
+										   !detail::stl_has_type_traits_type<T>::value>
+{};
+
+template <typename T>
+struct generic_emitter<T, 3, enable_if_t<detail::stl_is_contiguous_tensor<T>::value>>
+{
+	inline static Emitter& emit(Emitter& emitter, const T& value)
+	{
+		if (value.size() < YAML_DEF_EMIT_BINARY_TENSOR_MIN_SIZE)
+		{
+			return detail::emit_sequence(emitter, value);
+		}
+
+		return detail::emit_binary_tensor(emitter, value.data(),
+										  {static_cast<std::size_t>(value.size())});
+	}
+};
+
+#endif
+
 //// std::map, std::unordered_map
 
 template <typename T>
@@ -6,9 +6,16 @@ Copyright (c) 2019 Macrobull
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iomanip>
 #include <iosfwd>
+#include <ostream>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
@@ -30,6 +37,47 @@ Copyright (c) 2019 Macrobull
 
 #endif
 
+#ifndef YSL_CONTEXT_POOL_SIZE // max number of released context states kept for reuse
+
+#define YSL_CONTEXT_POOL_SIZE 64
+
+#endif
+
+#ifndef YSL_CONTEXT_RECORD_SIZE // max text size of a glog record published by a YSL::Context
+
+#define YSL_CONTEXT_RECORD_SIZE 16384 // HINT: below glog kMaxLogMessageLen with the prefix
+
+#endif
+
+#ifndef YSL_STAT_PERIOD // default number of samples summarized in a frame of YSL_STAT
+
+#define YSL_STAT_PERIOD 1000
+
+#endif
+
+#ifndef YSL_STAT_PERIOD_MS // default max milliseconds between frames of YSL_STAT, 0 to disable
+
+#define YSL_STAT_PERIOD_MS 10000
+
+#endif
+
+#ifndef YSL_DELTA_KEYFRAME_PERIOD // a full keyframe every N frames of a delta frame name
+
+#define YSL_DELTA_KEYFRAME_PERIOD 100
+
+#endif
+
+#ifndef YSL_PROFILE_PERIOD_MS // min milliseconds between thread profile frames, 0 to disable
+
+#define YSL_PROFILE_PERIOD_MS 10000
+
+#endif
+
+// define YSL_TIMER_NO_TSC to time scopes by std::chrono::steady_clock only,
+//   otherwise TSC is used on x86 if invariant
+
+// #define YSL_TIMER_NO_TSC
+
 //// YSL interfaces
 
 namespace YSL_NS
@@ -70,6 +118,368 @@ struct ThreadFrame
 	ThreadFrame(std::string rv_name, std::size_t rv_fill_width, bool rv_reset) noexcept;
 };
 
+// threaded frame of value rows, the schema document(keys and optional types) is written once
+// per thread before the first row, then each frame is a flow sequence of values only,
+// see YSL_ROW
+struct FrameSchema
+{
+	const std::string              name;
+	const std::vector<std::string> keys;
+	const std::vector<std::string> types; // optional
+	const std::size_t              fill_width{30};
+
+	FrameSchema(std::string rv_name, std::vector<std::string> rv_keys,
+				std::vector<std::string> rv_types = {}) noexcept;
+};
+
+// runtime filter of frames by name, checked as a ThreadFrame or FrameSchema starts a document,
+// a rejected frame mutes all YSL statements of the thread(or context) until the document ends,
+// without formatting or glog messages, only the frame index advances
+//   patterns are separated by ',' or whitespace, with wildcards '*' and '?',
+//   patterns prefixed by '-' exclude, a frame is accepted if the last matched pattern includes,
+//   or if no pattern matched and there is no including pattern
+//   patterns are loaded on first use from env YSL_FRAME_FILTER and the file named by env
+//   YSL_FRAME_FILTER_FILE(a pattern per line, '#' for comments), and again on reload
+class FrameFilter
+{
+public:
+	// replace the patterns
+	static void set(const std::string& patterns);
+	// replace the patterns with the content of file `path`, false if failed to read
+	static bool load(const std::string& path);
+	// reload the patterns from env
+	static void reload();
+
+	static bool accept(const std::string& name);
+};
+
+// opt-in delta frames by name, in a delta frame of the thread(or context), scalar values
+// (arithmetic, bool and strings) under mapping keys are skipped if unchanged since the last
+// frame of the same name, mappings without changes are skipped as well, the root mapping is
+// tagged !delta, and every YSL_DELTA_KEYFRAME_PERIOD frames a full keyframe is written
+// without tag, see resolve_delta in python/parsers.py
+//   other values(e.g. containers) and sequences are always written, modifiers(e.g. Flow,
+//   FloatPrecision, Comment) in a mapping are only written with the next written entry
+//   patterns as FrameFilter, but no frame is delta without patterns, loaded on first use
+//   from env YSL_DELTA_FRAMES and the file named by env YSL_DELTA_FRAMES_FILE
+class DeltaFrames
+{
+public:
+	// replace the patterns
+	static void set(const std::string& patterns);
+	// replace the patterns with the content of file `path`, false if failed to read
+	static bool load(const std::string& path);
+	// reload the patterns from env
+	static void reload();
+
+	static bool enabled(const std::string& name);
+};
+
+namespace detail
+{
+
+struct DeltaFrame;
+
+// writer of delta frames between StreamLogger and the emitter, keys in mappings are deferred
+// until their values are known to be changed
+class DeltaWriter
+{
+public:
+	using Modifier = std::function<void(Emitter&)>;
+
+	// start a document of `frame` in `stream`, values are all written if `keyframe`
+	void begin(std::ostream& stream, DeltaFrame* frame, bool keyframe);
+
+	// write `value` if necessary
+	template <typename T>
+	inline void write(Emitter& emitter, const T& value)
+	{
+		write(emitter, value, category<T>{});
+	}
+
+	// handle manipulator `value`, false if it should be written as is
+	bool manip(Emitter& emitter, EMITTER_MANIP value);
+
+private:
+	enum class State
+	{
+		Key,          // expecting key
+		PendingValue, // key deferred
+		Value,        // key written
+	};
+
+	struct Level
+	{
+		bool                  map{false};
+		bool                  written{false};
+		State                 state{State::Key};
+		std::uint64_t         path{0};
+		std::string           key{};
+		std::vector<Modifier> modifiers{};
+		std::size_t           key_modifiers{0}; // number of modifiers before the key
+	};
+
+	// clang-format off
+	template <typename T>
+	using category = std::integral_constant<int,
+			std::is_arithmetic<T>::value && !std::is_same<T, long double>::value ? 1 :
+			std::is_same<T, std::string>::value || std::is_same<T, const char*>::value ||
+			std::is_same<T, char*>::value ? 2 :
+			std::is_same<T, _Precision>::value || std::is_same<T, _Tag>::value ||
+			std::is_same<T, _Comment>::value || std::is_same<T, _Indent>::value ? 3 : 0>;
+	// clang-format on
+
+	// FNV-1a
+	static std::uint64_t hash(const void* data, std::size_t size,
+							  std::uint64_t seed = 14695981039346656037ull) noexcept;
+
+	// any other node
+	template <typename T>
+	inline void write(Emitter& emitter, const T& value, std::integral_constant<int, 0>)
+	{
+		node(emitter);
+		emitter << value;
+	}
+
+	// arithmetic scalar
+	template <typename T>
+	inline void write(Emitter& emitter, const T& value, std::integral_constant<int, 1>)
+	{
+		if (scalar(emitter, hash(&value, sizeof(T))))
+		{
+			emitter << value;
+		}
+	}
+
+	// string scalar
+	inline void write(Emitter& emitter, const std::string& value, std::integral_constant<int, 2>)
+	{
+		if (text(emitter, value.data(), value.size()))
+		{
+			emitter << value;
+		}
+	}
+
+	inline void write(Emitter& emitter, const char* value, std::integral_constant<int, 2>)
+	{
+		if (text(emitter, value, std::char_traits<char>::length(value)))
+		{
+			emitter << value;
+		}
+	}
+
+	template <std::size_t N>
+	inline void write(Emitter& emitter, const char (&value)[N], std::integral_constant<int, 0>)
+	{
+		write(emitter, static_cast<const char*>(value), std::integral_constant<int, 2>{});
+	}
+
+	// modifier
+	template <typename T>
+	inline void write(Emitter& emitter, const T& value, std::integral_constant<int, 3>)
+	{
+		if (!modifier([value](Emitter& target) { target << value; }))
+		{
+			emitter << value;
+		}
+	}
+
+	// a string is deferred as key if expected, true if it should be written as scalar
+	bool text(Emitter& emitter, const char* data, std::size_t size);
+	// a scalar of `value_hash`, true if it should be written
+	bool scalar(Emitter& emitter, std::uint64_t value_hash);
+	// any other node is written
+	void node(Emitter& emitter);
+	// a modifier is deferred in a mapping, false otherwise
+	bool modifier(Modifier value);
+
+	// write the deferred mappings and the deferred key of the top level
+	void flush(Emitter& emitter, bool with_key);
+	void push(bool map, bool written, std::uint64_t path);
+
+	std::ostream*      m_stream{nullptr};
+	DeltaFrame*        m_frame{nullptr};
+	bool               m_keyframe{false};
+	bool               m_dirty{false}; // written since the last Newline
+	std::vector<Level> m_levels{};     // HINT: reused, see m_depth
+	std::size_t        m_depth{0};
+};
+
+// P² estimator of the `p`-quantile in fixed memory, see @ref https://doi.org/10.1145/4372.4378
+class QuantileEstimator
+{
+public:
+	explicit QuantileEstimator(double p) noexcept;
+
+	// add the `count`-th sample
+	void add(double value, std::size_t count);
+	// estimation from `count` samples
+	double value(std::size_t count) const;
+
+	void clear() noexcept;
+
+private:
+	const double m_p;
+	double       m_heights[5];
+	double       m_positions[5];
+	double       m_desired[5];
+};
+
+} // namespace detail
+
+// online summary of samples in fixed memory: count, min, max, mean, variance and
+// estimated quantiles
+class Statistics
+{
+public:
+	Statistics() noexcept;
+
+	void add(double value);
+	void clear() noexcept;
+
+	inline std::size_t count() const noexcept
+	{
+		return m_count;
+	}
+
+	inline double min() const noexcept
+	{
+		return m_min;
+	}
+
+	inline double max() const noexcept
+	{
+		return m_max;
+	}
+
+	inline double mean() const noexcept
+	{
+		return m_mean;
+	}
+
+	// population variance
+	double variance() const noexcept;
+
+	double p50() const;
+	double p90() const;
+	double p99() const;
+
+private:
+	std::size_t               m_count{0};
+	double                    m_min{}, m_max{}, m_mean{}, m_m2{};
+	detail::QuantileEstimator m_p50{.5}, m_p90{.9}, m_p99{.99};
+};
+
+// emit as flow mapping of count, min, max, mean, variance, p50, p90 and p99
+Emitter& operator<<(Emitter& emitter, const Statistics& value);
+
+// periodic aggregator of a YSL_STAT callsite in a thread, a summary is due every `period`
+// samples, or on the first sample after `period_ms` milliseconds if nonzero
+class StatAggregator
+{
+public:
+	explicit StatAggregator(std::size_t period = YSL_STAT_PERIOD,
+							std::size_t period_ms = YSL_STAT_PERIOD_MS) noexcept;
+
+	// add a sample, true if the summary is due
+	bool add(double value);
+
+	// take the summary and restart
+	Statistics flush();
+
+	inline const Statistics& statistics() const noexcept
+	{
+		return m_statistics;
+	}
+
+private:
+	Statistics                            m_statistics;
+	const std::size_t                     m_period;
+	const std::chrono::milliseconds       m_period_ms;
+	std::chrono::steady_clock::time_point m_start{};
+};
+
+namespace detail
+{
+
+// monotonic ticks for timed scopes
+std::uint64_t timer_ticks();
+// nanoseconds per tick of timer_ticks
+double timer_tick_ns();
+
+struct ContextState;
+
+// streambuf appending to a std::string
+class StringStreamBuf : public std::streambuf
+{
+public:
+	explicit StringStreamBuf(std::string& data) noexcept
+		: m_data(data)
+	{}
+
+protected:
+	inline int overflow(int c) override
+	{
+		m_data.push_back(static_cast<char>(c));
+		return c;
+	}
+
+	inline std::streamsize xsputn(const char* s, std::streamsize n) override
+	{
+		m_data.append(s, static_cast<std::size_t>(n));
+		return n;
+	}
+
+private:
+	std::string& m_data;
+};
+
+} // namespace detail
+
+// movable logging context owning an emitter, a stream and the frame states,
+// for tasks migrating between threads, see YSL_CTX,
+// states are recycled in a lock-free pool, the thread default context is used otherwise
+// the text is buffered in the context and published as glog records headed by
+// "# YSL::Context <id>", a document at once as it completes(next document, EndDoc or the end
+// of the context), or in pieces of YSL_CONTEXT_RECORD_SIZE, headed by "# YSL::Context <id> +"
+// if continued in the next record, so readers reassemble documents by the context id
+// instead of the glog thread id, see parsers.lazy_frame_parser
+class Context
+{
+public:
+	Context();
+	~Context();
+
+	Context(const Context&) = delete;
+
+	Context(Context&& xvalue) noexcept;
+
+	Context& operator=(const Context&) = delete;
+
+	Context& operator=(Context&& xvalue) noexcept;
+
+	// format control of the context
+	bool set_format(EMITTER_MANIP value);
+	bool set_format(LoggerFormat value, std::size_t n);
+
+	// frame index of the context, see ThreadFrame::index
+	std::size_t frame_index() const;
+
+	// id in the record headers, unique in the process
+	std::uint64_t id() const;
+
+	// publish the buffered text, e.g. before a long task without logging
+	void flush();
+
+	inline detail::ContextState* state() const noexcept
+	{
+		return m_state;
+	}
+
+private:
+	detail::ContextState* m_state{nullptr};
+};
+
 // the YSL logger class
 class StreamLogger
 {
@@ -87,11 +497,18 @@ class StreamLogger
 
 		bool empty_line(); // const
 
+		// attach the filter buffer of the context stream
+		inline void attach(std::streambuf* filter_buf) noexcept
+		{
+			m_filter_buf = filter_buf;
+		}
+
 	protected:
 		void reset();
 
 	private:
-		size_t m_init_count{};
+		size_t          m_init_count{};
+		std::streambuf* m_filter_buf{nullptr};
 	};
 
 public:
@@ -102,9 +519,23 @@ public:
 	// forward constructor
 	template <typename... CArgs>
 	explicit StreamLogger(CArgs... args)
-		: m_message(std::forward<CArgs>(args)...)
+		: m_context(context_state(nullptr))
+		, m_muted(context_muted(m_context))
+		, m_delta(context_delta(m_context))
 	{
-		reset();
+		init(std::forward<CArgs>(args)...);
+	}
+
+	// log with `context`, or the thread default context if null
+	StreamLogger(Context* context, const char* file, int line, google::LogSeverity severity)
+		: m_context(context_state(context))
+		, m_muted(context_muted(m_context))
+		, m_delta(context_delta(m_context))
+	{
+		if (!begin_record(file, line, severity))
+		{
+			init(file, line, severity);
+		}
 	}
 
 	~StreamLogger();
@@ -117,8 +548,18 @@ public:
 	template <typename T>
 	inline StreamLogger& operator<<(const T& value)
 	{
-		m_implicit_eol = true;
-		thread_emitter() << value;
+		if (!m_muted)
+		{
+			m_implicit_eol = true;
+			if (m_delta == nullptr)
+			{
+				context_emitter() << value;
+			}
+			else
+			{
+				m_delta->write(context_emitter(), value);
+			}
+		}
 		return *this;
 	}
 
@@ -134,6 +575,8 @@ public:
 	StreamLogger& operator<<(EMITTER_MANIP value);
 	// ThreadFrame
 	StreamLogger& operator<<(const ThreadFrame& value);
+	// FrameSchema, begin a value row
+	StreamLogger& operator<<(const FrameSchema& value);
 
 	// whether the end-of-line is implicit set by YAML internally
 	inline bool is_implicit_eol() const
@@ -152,14 +595,50 @@ public:
 
 protected:
 	// internal stubs
-	static Emitter&      thread_emitter();
-	static std::ostream& thread_stream();
+	static detail::ContextState* context_state(Context* context);
+	static bool&                 context_muted(detail::ContextState* context);
+	static detail::DeltaWriter*& context_delta(detail::ContextState* context);
+
+	Emitter&      context_emitter();
+	std::ostream& context_stream();
 
 	void reset();
+	// end muting by FrameFilter, the message is constructed if deferred
+	void unmute();
+
+	// buffer into the record of a Context instead of glog messages, false for the thread
+	// default context
+	bool begin_record(const char* file, int line, google::LogSeverity severity);
+	// end the line in the record, an empty line is dropped as by SkipEmptyLogMessage
+	void end_record_line();
+	// publish the record of a Context, `continued` if the document is not complete
+	void publish_record(bool continued);
 
 private:
-	StackStorage<Reconstructable<SkipEmptyLogMessage>> m_message;
-	bool                                               m_implicit_eol{};
+	using Message = Reconstructable<SkipEmptyLogMessage>;
+
+	template <typename... CArgs>
+	inline void init(CArgs... args)
+	{
+		if (m_muted) // HINT: defer the message until unmuted, as glog formats on construction
+		{
+			using Deferred = ReconstructorImpl<Message, CArgs...>;
+			static_assert(sizeof(Deferred) <= sizeof(m_deferred_storage), "too many arguments");
+			m_deferred = new (m_deferred_storage) Deferred(std::forward<CArgs>(args)...);
+			return;
+		}
+
+		m_message.construct(std::forward<CArgs>(args)...);
+		reset();
+	}
+
+	detail::ContextState* const       m_context;
+	bool&                             m_muted;
+	detail::DeltaWriter*&             m_delta; // of the current document, if delta
+	StackStorage<Message>             m_message;
+	const ReconstructorBase<Message>* m_deferred{nullptr};
+	alignas(alignof(std::max_align_t)) char m_deferred_storage[64]; // for m_deferred
+	bool                              m_implicit_eol{};
 };
 
 // voidifier, see @ref google::LogMessageVoidify
@@ -169,6 +648,66 @@ struct LoggerVoidify
 	inline void operator&(const StreamLogger& /*logger*/) {}
 };
 
+// caller-owned reusable capture buffer, YAML is emitted straight into the reserved storage
+// without glog prefixes, glog objects or locks, see YSL_TO_BUFFER
+// the emitter and its format are kept between payloads
+class Buffer
+{
+public:
+	explicit Buffer(std::size_t capacity = 4096);
+
+	Buffer(const Buffer&) = delete;
+
+	Buffer& operator=(const Buffer&) = delete;
+
+	// forward YAML-type value
+	template <typename T>
+	inline Buffer& operator<<(const T& value)
+	{
+		m_emitter << value;
+		return *this;
+	}
+
+	// format control of the buffer
+	bool set_format(EMITTER_MANIP value);
+	bool set_format(LoggerFormat value, std::size_t n);
+
+	// end the payload and clear the buffer for reuse, the storage is kept
+	void clear();
+
+	inline const std::string& str() const noexcept
+	{
+		return m_data;
+	}
+
+	inline const char* data() const noexcept
+	{
+		return m_data.data();
+	}
+
+	inline std::size_t size() const noexcept
+	{
+		return m_data.size();
+	}
+
+	inline const Emitter& emitter() const noexcept
+	{
+		return m_emitter;
+	}
+
+	// self call
+	inline Buffer& self()
+	{
+		return *this;
+	}
+
+private:
+	std::string              m_data;
+	detail::StringStreamBuf  m_streambuf;
+	std::ostream             m_stream;
+	Reconstructable<Emitter> m_emitter;
+};
+
 // RAII mapping scope
 template <typename... End>
 class Scope
@@ -176,16 +715,18 @@ class Scope
 public:
 	template <typename... Begin>
 	Scope(const char* file, int line, google::LogSeverity severity,
-		  const Sequential<Begin...>& begin, Sequential<End...> end, bool enabled = true)
+		  const Sequential<Begin...>& begin, Sequential<End...> end, bool enabled = true,
+		  Context* context = nullptr)
 		: m_end(std::move(end))
 		, m_file(file)
 		, m_line(line)
 		, m_severity(severity)
 		, m_enabled(enabled)
+		, m_context(context)
 	{
 		if (sizeof...(Begin) > 0 && enabled)
 		{
-			m_logger.construct(file, line, severity);
+			m_logger.construct(context, file, line, severity);
 			*m_logger << begin;
 			m_logger.try_destruct();
 		}
@@ -200,7 +741,11 @@ public:
 
 	Scope(Scope&& xvalue) noexcept
 		: m_end(std::move(xvalue.m_end))
+		, m_file(xvalue.m_file)
+		, m_line(xvalue.m_line)
+		, m_severity(xvalue.m_severity)
 		, m_enabled(xvalue.m_enabled)
+		, m_context(xvalue.m_context)
 	{}
 
 	Scope& operator=(const Scope&) = delete; // force move
@@ -209,21 +754,33 @@ public:
 
 	template <typename... Args>
 	inline void enter(Args&&... args)
+	{
+		write(std::forward<Args>(args)...);
+	}
+
+protected:
+	inline bool enabled() const noexcept
+	{
+		return m_enabled;
+	}
+
+	// log `args` in the scope
+	template <typename... Args>
+	inline void write(Args&&... args)
 	{
 		if (sizeof...(Args) > 0 && m_enabled)
 		{
-			m_logger.construct(m_file, m_line, m_severity);
+			m_logger.construct(m_context, m_file, m_line, m_severity);
 			*m_logger << make_sequential(std::forward<Args>(args)...);
 			m_logger.try_destruct();
 		}
 	}
 
-protected:
 	inline void exit()
 	{
 		if (sizeof...(End) > 0 && m_enabled)
 		{
-			m_logger.construct(m_file, m_line, m_severity);
+			m_logger.construct(m_context, m_file, m_line, m_severity);
 			*m_logger << m_end;
 			m_logger.try_destruct();
 		}
@@ -236,17 +793,88 @@ private:
 	const int                  m_line{};
 	const google::LogSeverity  m_severity{};
 	const bool                 m_enabled{};
+	Context* const             m_context{};
 };
 
 template <typename... Begin, typename... End>
 inline Scope<End...>
 make_stream_logging_scope(const char* file, int line, google::LogSeverity severity,
 						  const Sequential<Begin...>& begin, const Sequential<End...>& end,
-						  bool enabled = true)
+						  bool enabled = true, Context* context = nullptr)
+{
+	return {file, line, severity, begin, end, enabled, context};
+}
+
+// RAII mapping scope logging the elapsed milliseconds as key "elapsed_ms" before the end
+template <typename... End>
+class TimedScope : public Scope<End...>
 {
-	return {file, line, severity, begin, end, enabled};
+public:
+	template <typename... Begin>
+	TimedScope(const char* file, int line, google::LogSeverity severity,
+			   const Sequential<Begin...>& begin, Sequential<End...> end, bool enabled = true,
+			   Context* context = nullptr)
+		: Scope<End...>(file, line, severity, begin, std::move(end), enabled, context)
+		, m_start(enabled ? detail::timer_ticks() : 0)
+	{}
+
+	~TimedScope()
+	{
+		if (this->enabled())
+		{
+			const auto elapsed = static_cast<double>(detail::timer_ticks() - m_start) *
+								 detail::timer_tick_ns() * 1e-6;
+			this->write(Key, "elapsed_ms", Value, elapsed);
+		}
+	}
+
+	TimedScope(const TimedScope&) = delete; // force move
+
+	TimedScope(TimedScope&& xvalue) noexcept
+		: Scope<End...>(std::move(xvalue))
+		, m_start(xvalue.m_start)
+	{}
+
+	TimedScope& operator=(const TimedScope&) = delete; // force move
+
+private:
+	const std::uint64_t m_start{};
+};
+
+template <typename... Begin, typename... End>
+inline TimedScope<End...>
+make_timed_logging_scope(const char* file, int line, google::LogSeverity severity,
+						 const Sequential<Begin...>& begin, const Sequential<End...>& end,
+						 bool enabled = true, Context* context = nullptr)
+{
+	return {file, line, severity, begin, end, enabled, context};
 }
 
+// RAII scope of the thread profile, calls, total, self and max time are aggregated per path
+// of nested scopes, the profile is logged as a frame with `severity` when a root scope
+// ends after YSL_PROFILE_PERIOD_MS, see YSL_PSCOPE and YSL_PROFILE
+class ProfileScope
+{
+public:
+	ProfileScope(const char* file, int line, google::LogSeverity severity, const char* name);
+	ProfileScope(const char* file, int line, google::LogSeverity severity,
+				 const std::string& name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+	// log the profile of current thread as a frame and restart
+	static void log(const char* file, int line, google::LogSeverity severity);
+
+private:
+	const char* const         m_file{};
+	const int                 m_line{};
+	const google::LogSeverity m_severity{};
+	std::uint64_t             m_start{};
+};
+
 } // namespace YSL_NS
 
 //// YSL macros, see LOG in @ref "glog/logging.h"
@@ -285,6 +913,7 @@ namespace YSL = YSL_NS; // define YSL
 	YSL_::StreamLogger(__FILE__, __LINE__, google::GLOG_##severity,                            \
 					   static_cast<std::vector<std::string>*>(outvec))                         \
 			.self()
+#define YSL_TO_BUFFER(buffer) (buffer).self()
 #define YSL_TO_SINK(sink, severity)                                                            \
 	YSL_::StreamLogger(__FILE__, __LINE__, google::GLOG_##severity,                            \
 					   static_cast<google::LogSink*>(sink), true)                              \
@@ -342,6 +971,30 @@ namespace YSL = YSL_NS; // define YSL
 #define VYSL_CSCOPE(verboselevel, name)                                                        \
 	VYSL_SCOPE_DECL_VAR(verboselevel, YSL_::Key, name, YSL_::Value, YSL_::Flow, YSL_::BeginMap)
 
+// TxSCOPE: timed scopes, the elapsed milliseconds is logged as key "elapsed_ms" at the end
+
+#define YSL_TSCOPE_(severity, ...)                                                             \
+	YSL_::make_timed_logging_scope(__FILE__, __LINE__, google::GLOG_##severity,                \
+								   YSL_::make_sequential(__VA_ARGS__),                         \
+								   YSL_::make_sequential(YSL_::EndMap))
+#define YSL_TSCOPE_DECL_VAR(severity, ...)                                                     \
+	const auto LOG_EVERY_N_VARNAME(ysl_tscope_, __LINE__) = YSL_TSCOPE_(severity, __VA_ARGS__)
+#define YSL_TSCOPE(severity) YSL_TSCOPE_DECL_VAR(severity, YSL_::BeginMap)
+#define YSL_TFSCOPE(severity, name)                                                            \
+	YSL_TSCOPE_DECL_VAR(severity, YSL_::ThreadFrame(name), YSL_::BeginMap)
+#define YSL_TMSCOPE(severity, name)                                                            \
+	YSL_TSCOPE_DECL_VAR(severity, YSL_::Key, name, YSL_::Value, YSL_::Block, YSL_::BeginMap)
+#define YSL_TCSCOPE(severity, name)                                                            \
+	YSL_TSCOPE_DECL_VAR(severity, YSL_::Key, name, YSL_::Value, YSL_::Flow, YSL_::BeginMap)
+
+// PSCOPE: profiled scope aggregated in the thread profile, nothing is logged per call
+
+#define YSL_PSCOPE(severity, name)                                                             \
+	const YSL_::ProfileScope LOG_EVERY_N_VARNAME(ysl_pscope_, __LINE__)(                       \
+			__FILE__, __LINE__, google::GLOG_##severity, name)
+#define YSL_PROFILE(severity)                                                                  \
+	YSL_::ProfileScope::log(__FILE__, __LINE__, google::GLOG_##severity)
+
 // IxSCOPE: named scopes with indexed key
 
 #define YSL_INDEXED_(name, id)                                                                 \
@@ -369,6 +1022,66 @@ namespace YSL = YSL_NS; // define YSL
 #define VYSL_LIC_IF(verboselevel, key, condition)                                              \
 	YSL_LIC_IF(INFO, key, (condition) && VLOG_IS_ON(verboselevel))
 
+// value row of FrameSchema
+
+#define YSL_ROW(severity, schema, ...)                                                         \
+	YSL(severity) << (schema) << YSL_::make_sequential(__VA_ARGS__) << YSL_::EndSeq
+#define VYSL_ROW(verboselevel, schema, ...)                                                    \
+	VYSL(verboselevel) << (schema) << YSL_::make_sequential(__VA_ARGS__) << YSL_::EndSeq
+
+// YSL_STAT: online summary of `value` per thread and callsite, only logged as a frame
+// named `key`(constant per callsite) every YSL_STAT_PERIOD samples or YSL_STAT_PERIOD_MS,
+// pending samples are discarded at thread exit
+
+#define YSL_STAT_VARNAME() LOG_EVERY_N_VARNAME(ysl_stat_, __LINE__)
+#define YSL_STAT_DECL_VAR(period, period_ms)                                                   \
+	static thread_local YSL_::StatAggregator YSL_STAT_VARNAME()(period, period_ms)
+#define YSL_STAT_EVERY_IF(severity, key, value, period, period_ms, condition)                \
+	YSL_STAT_DECL_VAR(period, period_ms);                                                      \
+	!((condition) && YSL_STAT_VARNAME().add(static_cast<double>(value)))                       \
+			? (void)0                                                                          \
+			: YSL_::LoggerVoidify() &                                                          \
+					  YSL(severity) << YSL_::ThreadFrame(key) << YSL_STAT_VARNAME().flush()
+#define YSL_STAT_EVERY(severity, key, value, period, period_ms)                                \
+	YSL_STAT_EVERY_IF(severity, key, value, period, period_ms, true)
+#define YSL_STAT_IF(severity, key, value, condition)                                           \
+	YSL_STAT_EVERY_IF(severity, key, value, YSL_STAT_PERIOD, YSL_STAT_PERIOD_MS, condition)
+#define YSL_STAT(severity, key, value) YSL_STAT_IF(severity, key, value, true)
+#define VYSL_STAT(verboselevel, key, value) YSL_STAT_IF(INFO, key, value, VLOG_IS_ON(verboselevel))
+#define VYSL_STAT_IF(verboselevel, key, value, condition)                                      \
+	YSL_STAT_IF(INFO, key, value, (condition) && VLOG_IS_ON(verboselevel))
+
+// YSL_CTX: log with a YSL::Context instead of the thread default context
+
+#define YSL_CTX(context, severity)                                                             \
+	YSL_::StreamLogger(&(context), __FILE__, __LINE__, google::GLOG_##severity).self()
+#define YSL_CTX_IF(context, severity, condition)                                               \
+	!(condition) ? (void)0 : YSL_::LoggerVoidify() & YSL_CTX(context, severity)
+#define VYSL_CTX(context, verboselevel) YSL_CTX_IF(context, INFO, VLOG_IS_ON(verboselevel))
+
+#define YSL_CTX_SCOPE_(context, severity, ...)                                                 \
+	YSL_::make_stream_logging_scope(__FILE__, __LINE__, google::GLOG_##severity,               \
+									YSL_::make_sequential(__VA_ARGS__),                        \
+									YSL_::make_sequential(YSL_::EndMap), true, &(context))
+#define YSL_CTX_SCOPE_DECL_VAR(context, severity, ...)                                         \
+	const auto LOG_EVERY_N_VARNAME(ysl_scope_, __LINE__) =                                     \
+			YSL_CTX_SCOPE_(context, severity, __VA_ARGS__)
+#define YSL_CTX_SCOPE(context, severity) YSL_CTX_SCOPE_DECL_VAR(context, severity, YSL_::BeginMap)
+#define YSL_CTX_SCOPED(context, severity)                                                      \
+	YSL_CTX_SCOPE_DECL_VAR(context, severity, YSL_::BeginMap);                                 \
+	YSL_CTX(context, severity)
+#define YSL_CTX_FSCOPE(context, severity, name)                                                \
+	YSL_CTX_SCOPE_DECL_VAR(context, severity, YSL_::ThreadFrame(name), YSL_::BeginMap)
+#define YSL_CTX_MSCOPE(context, severity, name)                                                \
+	YSL_CTX_SCOPE_DECL_VAR(context, severity, YSL_::Key, name, YSL_::Value, YSL_::Block,       \
+						   YSL_::BeginMap)
+#define YSL_CTX_CSCOPE(context, severity, name)                                                \
+	YSL_CTX_SCOPE_DECL_VAR(context, severity, YSL_::Key, name, YSL_::Value, YSL_::Flow,        \
+						   YSL_::BeginMap)
+
+#define YSL_CTX_ROW(context, severity, schema, ...)                                            \
+	YSL_CTX(context, severity) << (schema) << YSL_::make_sequential(__VA_ARGS__) << YSL_::EndSeq
+
 // DYSL
 
 #define DLOG_(func) !(DCHECK_IS_ON()) ? (void)0 : google::LogMessageVoidify() & func
@@ -6,10 +6,30 @@ Copyright (c) 2019 Macrobull
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 #include "ysl.hpp"
 
+#if !defined(YSL_TIMER_NO_TSC) && (defined(__x86_64__) || defined(__i386__)) &&                \
+		(defined(__GNUC__) || defined(__clang__))
+
+#define YSL_TIMER_TSC
+
+#include <cpuid.h>
+#include <x86intrin.h>
+
+#endif
+
 #ifdef YSL_PRIVATE_IMPL
 
 #define YSL_IMPL_NS
@@ -164,18 +184,200 @@ namespace detail
 
 using log_level_t = decltype(FLAGS_minloglevel);
 
-inline YSL_IMPL_NS_ FilterForwardOutStream& thread_stream()
+// states of a delta frame name in a context
+struct DeltaFrame
 {
-	// HINT: destruct until the thread ends
-	static thread_local FilterForwardOutStream ret{};
+	std::size_t                                       generation{0}; // of the rules
+	bool                                              enabled{false};
+	std::size_t                                       count{0}; // frames since enabled
+	std::unordered_map<std::uint64_t, std::uint64_t> values{};  // value hash by key path hash
+};
+
+// file, line and severity of glog messages
+struct MessageHead
+{
+	const char*         file{""};
+	int                 line{0};
+	google::LogSeverity severity{google::GLOG_INFO};
+};
+
+// logging states of a context
+struct ContextState
+{
+	// HINT: type erased, FilterForwardOutStream is of internal linkage with YSL_PRIVATE_IMPL
+	const std::unique_ptr<std::ostream> stream;
+	Reconstructable<Emitter>            emitter;
+	std::size_t                         frame_index{0};
+	bool                                muted{false}; // by FrameFilter
+	// keys of FrameSchema by name, whose schema document is written in the context
+	std::unordered_map<std::string, std::vector<std::string>> frame_schemas{};
+	// states of DeltaFrames by name, and the writer of the current delta document
+	std::unordered_map<std::string, DeltaFrame> delta_frames{};
+	DeltaWriter                                 delta_writer{};
+	DeltaWriter*                                delta{nullptr};
+	// buffered text of a Context(id > 0) to publish, see publish_record
+	std::uint64_t   id{0};
+	std::string     record{};
+	StringStreamBuf record_buf{record};
+	std::ostream    record_stream{&record_buf};
+	std::size_t     line_begin{0};    // of the current line in the record
+	bool            continued{false}; // the last published record is continued
+	MessageHead     head{};           // of the first statement in the record
+	MessageHead     statement{};      // of the current statement
+
+	ContextState()
+		: stream(new YSL_IMPL_NS_ FilterForwardOutStream{})
+		, emitter((std::reference_wrapper<std::ostream>(*stream))) // HINT: use UI
+	{}
+
+	ContextState(const ContextState&) = delete;
+
+	ContextState& operator=(const ContextState&) = delete;
+
+	// reset for reuse, an unfinished document is discarded
+	inline void reset()
+	{
+		emitter.reconstruct();
+		frame_index = 0;
+		muted       = false;
+		frame_schemas.clear();
+		delta_frames.clear();
+		delta = nullptr;
+		id    = 0;
+		record.clear();
+		line_begin = 0;
+		continued  = false;
+	}
+};
+
+inline std::uint64_t next_context_id()
+{
+	// HINT: static variable lifetime
+	static std::atomic<std::uint64_t> ret{0};
+	return ++ret;
+}
+
+// publish the record of `context` as glog records of at most YSL_CONTEXT_RECORD_SIZE text,
+// split at lines, the header is " +" terminated if continued in the next record, an empty
+// record is published only to end a continued one
+inline void publish_record(ContextState& context, bool continued)
+{
+	auto& record = context.record;
+	if (record.empty() && (continued || !context.continued))
+	{
+		return;
+	}
+
+	std::size_t begin = 0;
+	do
+	{
+		auto end = record.size();
+		if (end - begin > YSL_CONTEXT_RECORD_SIZE)
+		{
+			// HINT: a longer line is published alone, and truncated by glog
+			auto pos = record.rfind('\n', begin + YSL_CONTEXT_RECORD_SIZE - 1);
+			if (pos == std::string::npos || pos < begin)
+			{
+				pos = record.find('\n', begin);
+			}
+			end = pos != std::string::npos ? pos + 1 : record.size();
+		}
+
+		const bool more = end < record.size() || continued;
+		auto&      head = context.head;
+		google::LogMessage message(head.file, head.line, head.severity);
+		message.stream() << "# YSL::Context " << context.id << (more ? " +\n" : "\n");
+		// HINT: glog ends the message with a newline
+		message.stream().write(record.data() + begin,
+							   static_cast<std::streamsize>(
+									   end - begin - (end > begin && record[end - 1] == '\n')));
+		begin = end;
+	} while (begin < record.size());
+
+	record.clear();
+	context.line_begin = 0;
+	context.continued  = continued;
+	context.head       = context.statement;
+}
+
+// lock-free pool of released context states, a state is exchanged in and out of a slot,
+// states beyond the capacity are deleted
+class ContextPool
+{
+public:
+	ContextPool() noexcept
+	{
+		for (auto& slot : m_slots)
+		{
+			slot.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	~ContextPool()
+	{
+		for (auto& slot : m_slots)
+		{
+			delete slot.exchange(nullptr, std::memory_order_acquire);
+		}
+	}
+
+	ContextPool(const ContextPool&) = delete;
+
+	ContextPool& operator=(const ContextPool&) = delete;
+
+	inline ContextState* acquire()
+	{
+		for (auto& slot : m_slots)
+		{
+			if (slot.load(std::memory_order_relaxed) != nullptr)
+			{
+				const auto state = slot.exchange(nullptr, std::memory_order_acquire);
+				if (state != nullptr)
+				{
+					return state;
+				}
+			}
+		}
+		return new ContextState{};
+	}
+
+	inline void release(ContextState* state)
+	{
+		state->reset();
+		for (auto& slot : m_slots)
+		{
+			ContextState* expected = nullptr;
+			if (slot.load(std::memory_order_relaxed) == nullptr &&
+				slot.compare_exchange_strong(expected, state, std::memory_order_release,
+											 std::memory_order_relaxed))
+			{
+				return;
+			}
+		}
+		delete state;
+	}
+
+private:
+	std::atomic<ContextState*> m_slots[YSL_CONTEXT_POOL_SIZE];
+};
+
+inline ContextPool& context_pool()
+{
+	// HINT: static variable lifetime
+	static ContextPool ret{};
 	return ret;
 }
 
-inline Reconstructable<Emitter>& thread_emitter()
+inline ContextState& thread_context()
 {
 	// HINT: destruct until the thread ends
-	static thread_local Reconstructable<Emitter> ret(
-			(std::reference_wrapper<FilterForwardOutStream>(thread_stream()))); // HINT: use UI
+	static thread_local ContextState ret{};
+	return ret;
+}
+
+inline Reconstructable<Emitter>& checked_emitter(ContextState& context)
+{
+	auto& ret = context.emitter;
 	if (!ret.good())
 	{
 		LOGC(ERROR);
@@ -188,6 +390,16 @@ inline Reconstructable<Emitter>& thread_emitter()
 	return ret;
 }
 
+inline Reconstructable<Emitter>& thread_emitter()
+{
+	return checked_emitter(thread_context());
+}
+
+inline YSL_IMPL_NS_ FilterForwardOutStream& context_stream(ContextState& context)
+{
+	return static_cast<YSL_IMPL_NS_ FilterForwardOutStream&>(*context.stream);
+}
+
 inline std::mutex& minloglevel_mutex()
 {
 	// HINT: static variable lifetime
@@ -208,92 +420,395 @@ inline log_level_t min_log_level()
 	return ret;
 }
 
-inline std::size_t& thread_frame_index()
+// rules of frame names for FrameFilter and DeltaFrames, loaded from env `env_name` and the
+// file named by env `env_file_name`, the decisions of accept are cached per thread until the
+// generation changes
+class FrameFilterState
 {
-	static thread_local size_t ret(0);
-	return ret;
-}
+public:
+	FrameFilterState(const char* env_name, const char* env_file_name)
+		: m_env_name(env_name)
+		, m_env_file_name(env_file_name)
+	{
+		reload();
+	}
 
-} // namespace detail
+	inline void set(const std::string& patterns)
+	{
+		std::vector<std::pair<bool, std::string>> rules;
+		std::istringstream                        stream(patterns);
+		std::string                               line;
+		while (std::getline(stream, line))
+		{
+			line = line.substr(0, line.find('#'));
+			std::replace(line.begin(), line.end(), ',', ' ');
 
-namespace YSL_IMPL_NS
-{
+			std::istringstream line_stream(line);
+			std::string        pattern;
+			while (line_stream >> pattern)
+			{
+				const bool include = pattern[0] != '-';
+				rules.emplace_back(include, include ? pattern : pattern.substr(1));
+			}
+		}
 
-inline void bypass_glog_flush()
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_rules = std::move(rules);
+		m_empty.store(m_rules.empty(), std::memory_order_relaxed);
+		m_generation.fetch_add(1, std::memory_order_release);
+	}
+
+	inline void reload()
+	{
+		std::string patterns;
+		if (const auto env = std::getenv(m_env_name))
+		{
+			patterns.append(env).push_back('\n');
+		}
+		if (const auto path = std::getenv(m_env_file_name))
+		{
+			std::ifstream file(path);
+			patterns.append(std::istreambuf_iterator<char>(file), {});
+		}
+		set(patterns);
+	}
+
+	inline bool empty() const noexcept
+	{
+		return m_empty.load(std::memory_order_relaxed);
+	}
+
+	inline std::size_t generation() const noexcept
+	{
+		return m_generation.load(std::memory_order_acquire);
+	}
+
+	// whether `name` is accepted by the rules, without cache
+	inline bool match(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		bool                        ret = true;
+		for (const auto& rule : m_rules)
+		{
+			if (rule.first)
+			{
+				ret = false;
+				break;
+			}
+		}
+		for (const auto& rule : m_rules)
+		{
+			if (match(rule.second.c_str(), name.c_str()))
+			{
+				ret = rule.first;
+			}
+		}
+		return ret;
+	}
+
+	inline bool accept(const std::string& name)
+	{
+		if (empty())
+		{
+			return true;
+		}
+
+		struct Cache
+		{
+			std::size_t                           generation{0};
+			std::unordered_map<std::string, bool> decisions{};
+		};
+
+		// HINT: per instance, frame filter and delta frame rules have their own decisions
+		static thread_local std::unordered_map<const FrameFilterState*, Cache> caches{};
+
+		auto&      cache      = caches[this];
+		const auto generation = this->generation();
+		if (cache.generation != generation || cache.decisions.size() >= 1024) // HINT: bounded
+		{
+			cache.generation = generation;
+			cache.decisions.clear();
+		}
+
+		const auto it = cache.decisions.find(name);
+		if (it != cache.decisions.end())
+		{
+			return it->second;
+		}
+
+		const bool ret = match(name);
+		cache.decisions.emplace(name, ret);
+		return ret;
+	}
+
+private:
+	// glob match with '*' and '?'
+	inline static bool match(const char* pattern, const char* text)
+	{
+		const char* star      = nullptr;
+		const char* backtrack = nullptr;
+		while (*text != '\0')
+		{
+			if (*pattern == '*')
+			{
+				star      = ++pattern;
+				backtrack = text;
+			}
+			else if (*pattern == '?' || *pattern == *text)
+			{
+				++pattern;
+				++text;
+			}
+			else if (star != nullptr)
+			{
+				pattern = star;
+				text    = ++backtrack;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		while (*pattern == '*')
+		{
+			++pattern;
+		}
+		return *pattern == '\0';
+	}
+
+	const char* const                         m_env_name;
+	const char* const                         m_env_file_name;
+	std::mutex                                m_mutex{};
+	std::vector<std::pair<bool, std::string>> m_rules{};
+	std::atomic<bool>                         m_empty{true};
+	std::atomic<std::size_t>                  m_generation{1};
+};
+
+inline FrameFilterState& frame_filter()
 {
-	detail::minloglevel_mutex().lock();
-	FLAGS_minloglevel = google::NUM_SEVERITIES;
+	// HINT: static variable lifetime
+	static FrameFilterState ret{"YSL_FRAME_FILTER", "YSL_FRAME_FILTER_FILE"};
+	return ret;
 }
 
-inline void restore_glog_state()
+inline FrameFilterState& delta_frame_rules()
 {
-	FLAGS_minloglevel = detail::min_log_level();
-	detail::minloglevel_mutex().unlock();
+	// HINT: static variable lifetime
+	static FrameFilterState ret{"YSL_DELTA_FRAMES", "YSL_DELTA_FRAMES_FILE"};
+	return ret;
 }
 
-} // namespace YSL_IMPL_NS
-
-YSL_IMPL_STORAGE std::size_t ThreadFrame::index()
+// start a document of frame `name` in `context`, the delta writer is returned if delta
+inline DeltaWriter* begin_delta_frame(ContextState& context, const std::string& name)
 {
-	return detail::thread_frame_index();
-}
+	auto& rules = delta_frame_rules();
+	if (rules.empty()) // no frame is delta without patterns
+	{
+		return nullptr;
+	}
 
-YSL_IMPL_STORAGE ThreadFrame::ThreadFrame(std::string rv_name) noexcept
-	: name(std::move(rv_name))
-{}
+	auto& frames = context.delta_frames;
+	auto  it     = frames.find(name);
+	if (it == frames.end())
+	{
+		if (frames.size() >= 1024 && !rules.match(name)) // HINT: bounded
+		{
+			return nullptr;
+		}
+		it = frames.emplace(name, DeltaFrame{}).first;
+	}
 
-YSL_IMPL_STORAGE
-ThreadFrame::ThreadFrame(std::string rv_name, std::size_t rv_fill_width, bool rv_reset) noexcept
-	: name(std::move(rv_name))
-	, fill_width(rv_fill_width)
-	, reset(rv_reset)
-{}
+	auto&      frame      = it->second;
+	const auto generation = rules.generation();
+	if (frame.generation != generation)
+	{
+		frame.generation = generation;
+		frame.enabled    = rules.match(name);
+		frame.count      = 0;
+	}
+	if (!frame.enabled)
+	{
+		return nullptr;
+	}
 
-YSL_IMPL_STORAGE StreamLogger::SkipEmptyLogMessage::~SkipEmptyLogMessage()
+	context.delta_writer.begin(*context.stream, &frame,
+							   frame.count++ % YSL_DELTA_KEYFRAME_PERIOD == 0);
+	return &context.delta_writer;
+}
+
+// source of timer_ticks, calibrated once
+struct TimerClock
 {
-	if (empty_line())
+	bool   tsc{false};
+	double tick_ns{1.};
+
+	TimerClock()
 	{
-		YSL_IMPL_NS_ bypass_glog_flush();
+		using clock = std::chrono::steady_clock;
+
+		tick_ns = static_cast<double>(clock::period::num) * 1e9 /
+				  static_cast<double>(clock::period::den);
+
+#ifdef YSL_TIMER_TSC
+
+		unsigned int eax{}, ebx{}, ecx{}, edx{};
+		if (__get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx) == 0 || (edx & (1u << 8)) == 0)
+		{
+			return; // no invariant TSC
+		}
+
+		// HINT: 2ms against steady_clock
+		const auto start      = clock::now();
+		const auto start_tick = __rdtsc();
+		auto       end        = start;
+		while (end - start < std::chrono::milliseconds{2})
+		{
+			end = clock::now();
+		}
+		const auto ticks = __rdtsc() - start_tick;
+		if (ticks > 0)
+		{
+			tsc     = true;
+			tick_ns = static_cast<double>(
+							  std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+									  .count()) /
+					  static_cast<double>(ticks);
+		}
+
+#endif
 	}
+};
+
+inline const TimerClock& timer_clock()
+{
+	// HINT: static variable lifetime
+	static const TimerClock ret{};
+	return ret;
 }
 
-YSL_IMPL_STORAGE bool StreamLogger::SkipEmptyLogMessage::empty_line() // const
+// node of ThreadProfile, times are in ticks
+struct ProfileNode
 {
-	auto buf = static_cast<google::base_logging::LogStreamBuf*>(stream().rdbuf());
-	if (buf->pcount() == m_init_count)
+	std::string              name;
+	std::size_t              parent{0};
+	std::vector<std::size_t> children{};
+	std::uint64_t            calls{0}, total{0}, children_total{0}, max{0};
+};
+
+// tree of nested profile scopes in a thread, nodes are kept and only counters are reset
+class ThreadProfile
+{
+public:
+	ThreadProfile()
+		: m_nodes(1)
+		, m_last_log(timer_ticks())
+	{}
+
+	inline void enter(const char* name, std::size_t size)
 	{
-		return true;
+		auto& children = m_nodes[m_current].children;
+		for (const auto child : children)
+		{
+			const auto& child_name = m_nodes[child].name;
+			if (child_name.size() == size && child_name.compare(0, size, name, size) == 0)
+			{
+				m_current = child;
+				return;
+			}
+		}
+
+		children.push_back(m_nodes.size());
+		m_nodes.emplace_back();
+		m_nodes.back().name.assign(name, size);
+		m_nodes.back().parent = m_current;
+		m_current             = m_nodes.size() - 1;
 	}
 
-	auto impl_buf = static_cast<YSL_IMPL_NS_ FilterForwardOutStreamBuf*>(
-			detail::thread_stream().rdbuf());
-	if (buf->pcount() == m_init_count + 1 && impl_buf->end_with_eol())
+	// exit current scope, true if the profile is due to log
+	inline bool exit(std::uint64_t elapsed)
 	{
-		return true;
+		auto& node = m_nodes[m_current];
+		++node.calls;
+		node.total += elapsed;
+		node.max = std::max(node.max, elapsed);
+		m_current = node.parent;
+		m_nodes[m_current].children_total += elapsed;
+
+		const auto period = static_cast<double>(YSL_PROFILE_PERIOD_MS) * 1e6;
+		return m_current == 0 && period > 0. &&
+			   static_cast<double>(timer_ticks() - m_last_log) * timer_tick_ns() >= period;
 	}
 
-	return false;
+	// emit as mapping of "/"-joined path to calls, total, self and max milliseconds,
+	// then reset the counters
+	template <typename E> // E can be any Emitter-like
+	inline void emit(E& emitter)
+	{
+		const auto ms = timer_tick_ns() * 1e-6;
+
+		emitter << BeginMap;
+		emit_children(emitter, 0, std::string(), ms);
+		emitter << EndMap;
+
+		for (auto& node : m_nodes)
+		{
+			node.calls          = 0;
+			node.total          = 0;
+			node.children_total = 0;
+			node.max            = 0;
+		}
+		m_last_log = timer_ticks();
+	}
+
+private:
+	template <typename E>
+	inline void emit_children(E& emitter, std::size_t index, const std::string& prefix, double ms)
+	{
+		for (const auto child : m_nodes[index].children)
+		{
+			const auto& node = m_nodes[child];
+			const auto  path = prefix + node.name;
+			if (node.calls > 0)
+			{
+				emitter << Key << path << Value << Flow << BeginMap;
+				emitter << Key << "calls" << Value << node.calls;
+				emitter << Key << "total_ms" << Value << static_cast<double>(node.total) * ms;
+				emitter << Key << "self_ms" << Value
+						<< static_cast<double>(node.total - node.children_total) * ms;
+				emitter << Key << "max_ms" << Value << static_cast<double>(node.max) * ms;
+				emitter << EndMap;
+			}
+			emit_children(emitter, child, path + "/", ms);
+		}
+	}
+
+	std::vector<ProfileNode> m_nodes; // [0] as root
+	std::size_t              m_current{0};
+	std::uint64_t            m_last_log{};
+};
+
+inline ThreadProfile& thread_profile()
+{
+	// HINT: destruct until the thread ends
+	static thread_local ThreadProfile ret{};
+	return ret;
 }
 
-YSL_IMPL_STORAGE void StreamLogger::SkipEmptyLogMessage::reset()
+inline std::size_t& thread_frame_index()
 {
-	auto buf     = static_cast<google::base_logging::LogStreamBuf*>(stream().rdbuf());
-	m_init_count = buf->pcount();
-	detail::min_log_level(); // ensure min_log_level initialized
+	return thread_context().frame_index;
 }
 
-YSL_IMPL_STORAGE bool StreamLogger::set_thread_format(EMITTER_MANIP value)
+inline bool set_format(Emitter& emitter, EMITTER_MANIP value)
 {
-	auto& emitter = thread_emitter();
 	return emitter.SetOutputCharset(value) || emitter.SetOutputCharset(value) ||
 		   emitter.SetStringFormat(value) || emitter.SetBoolFormat(value) ||
 		   emitter.SetIntBase(value) || emitter.SetSeqFormat(value) ||
 		   emitter.SetMapFormat(value);
 }
 
-YSL_IMPL_STORAGE bool StreamLogger::set_thread_format(LoggerFormat value, std::size_t n)
+inline bool set_format(Emitter& emitter, LoggerFormat value, std::size_t n)
 {
-	auto& emitter = thread_emitter();
 	switch (value)
 	{
 	case LoggerFormat::Indent:
@@ -323,10 +838,805 @@ YSL_IMPL_STORAGE bool StreamLogger::set_thread_format(LoggerFormat value, std::s
 	}
 }
 
-YSL_IMPL_STORAGE StreamLogger::~StreamLogger()
+// write the frame header as comment before the document start
+inline void write_frame_header(std::ostream& stream, const std::string& text,
+							   std::size_t fill_width)
 {
-	self() << Newline;
-	//	m_implicit_eol = true;
+	stream << "--- # ";
+	stream << std::setfill('-')
+		   << std::setw(static_cast<int>(
+					  std::max(text.size() + 1, fill_width + text.size() / 2)));
+	stream << text;
+	stream << std::setfill('-')
+		   << std::setw(std::max(1, static_cast<int>(fill_width - text.size() / 2)));
+	stream << ""
+		   << " # ";
+}
+
+} // namespace detail
+
+namespace YSL_IMPL_NS
+{
+
+inline void bypass_glog_flush()
+{
+	detail::minloglevel_mutex().lock();
+	FLAGS_minloglevel = google::NUM_SEVERITIES;
+}
+
+inline void restore_glog_state()
+{
+	FLAGS_minloglevel = detail::min_log_level();
+	detail::minloglevel_mutex().unlock();
+}
+
+} // namespace YSL_IMPL_NS
+
+YSL_IMPL_STORAGE std::size_t ThreadFrame::index()
+{
+	return detail::thread_frame_index();
+}
+
+YSL_IMPL_STORAGE ThreadFrame::ThreadFrame(std::string rv_name) noexcept
+	: name(std::move(rv_name))
+{}
+
+YSL_IMPL_STORAGE
+ThreadFrame::ThreadFrame(std::string rv_name, std::size_t rv_fill_width, bool rv_reset) noexcept
+	: name(std::move(rv_name))
+	, fill_width(rv_fill_width)
+	, reset(rv_reset)
+{}
+
+YSL_IMPL_STORAGE FrameSchema::FrameSchema(std::string rv_name, std::vector<std::string> rv_keys,
+										  std::vector<std::string> rv_types) noexcept
+	: name(std::move(rv_name))
+	, keys(std::move(rv_keys))
+	, types(std::move(rv_types))
+{}
+
+YSL_IMPL_STORAGE void FrameFilter::set(const std::string& patterns)
+{
+	detail::frame_filter().set(patterns);
+}
+
+YSL_IMPL_STORAGE bool FrameFilter::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	detail::frame_filter().set(
+			std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+	return true;
+}
+
+YSL_IMPL_STORAGE void FrameFilter::reload()
+{
+	detail::frame_filter().reload();
+}
+
+YSL_IMPL_STORAGE bool FrameFilter::accept(const std::string& name)
+{
+	return detail::frame_filter().accept(name);
+}
+
+YSL_IMPL_STORAGE void DeltaFrames::set(const std::string& patterns)
+{
+	detail::delta_frame_rules().set(patterns);
+}
+
+YSL_IMPL_STORAGE bool DeltaFrames::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	detail::delta_frame_rules().set(
+			std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+	return true;
+}
+
+YSL_IMPL_STORAGE void DeltaFrames::reload()
+{
+	detail::delta_frame_rules().reload();
+}
+
+YSL_IMPL_STORAGE bool DeltaFrames::enabled(const std::string& name)
+{
+	auto& rules = detail::delta_frame_rules();
+	return !rules.empty() && rules.match(name);
+}
+
+YSL_IMPL_STORAGE void detail::DeltaWriter::begin(std::ostream& stream, DeltaFrame* frame,
+												  bool keyframe)
+{
+	m_stream   = &stream;
+	m_frame    = frame;
+	m_keyframe = keyframe;
+	m_dirty    = true; // the frame header
+	m_depth    = 0;
+	if (keyframe) // HINT: keys removed since are forgotten
+	{
+		frame->values.clear();
+	}
+}
+
+YSL_IMPL_STORAGE bool detail::DeltaWriter::manip(Emitter& emitter, EMITTER_MANIP value)
+{
+	const auto top = m_depth > 0 ? &m_levels[m_depth - 1] : nullptr;
+	switch (value)
+	{
+	case BeginMap:
+	case BeginSeq:
+	{
+		const bool map = value == BeginMap;
+		if (top == nullptr) // root
+		{
+			if (map && !m_keyframe)
+			{
+				*m_stream << "!delta\n"; // HINT: yaml-cpp rejects LocalTag here, see FrameSchema
+			}
+			emitter << value;
+			m_dirty = true;
+			push(map, true, hash(nullptr, 0));
+			return true;
+		}
+
+		if (map && top->map && top->state == State::PendingValue) // deferred with its key
+		{
+			push(true, false, hash(top->key.data(), top->key.size(), top->path));
+			return true;
+		}
+
+		// HINT: sequences and mappings in them are not tracked
+		node(emitter);
+		emitter << value;
+		push(false, true, 0);
+		return true;
+	}
+	case EndMap:
+	case EndSeq:
+	{
+		if (top == nullptr)
+		{
+			return false;
+		}
+
+		--m_depth;
+		if (top->written)
+		{
+			emitter << value;
+			m_dirty = true;
+		}
+		if (m_depth > 0)
+		{
+			auto& parent = m_levels[m_depth - 1];
+			if (parent.state == State::PendingValue) // skipped without changes
+			{
+				parent.state = State::Key;
+				parent.modifiers.clear();
+				parent.key_modifiers = 0;
+			}
+		}
+		return true;
+	}
+	case Key:
+	{
+		return top != nullptr && top->map; // HINT: written with the deferred key
+	}
+	case Value:
+	{
+		return top != nullptr && top->map && top->state != State::Value;
+	}
+	case Newline:
+	{
+		if (!m_dirty) // nothing written in the line
+		{
+			return true;
+		}
+
+		m_dirty = false;
+		return false;
+	}
+	default:
+	{
+		if (top != nullptr && top->map && top->state != State::Value)
+		{
+			return modifier([value](Emitter& target) { target << value; });
+		}
+
+		m_dirty = true;
+		return false;
+	}
+	}
+}
+
+YSL_IMPL_STORAGE std::uint64_t detail::DeltaWriter::hash(const void* data, std::size_t size,
+														 std::uint64_t seed) noexcept
+{
+	auto bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		seed = (seed ^ bytes[i]) * 1099511628211ull;
+	}
+	return seed;
+}
+
+YSL_IMPL_STORAGE bool detail::DeltaWriter::text(Emitter& emitter, const char* data,
+												 std::size_t size)
+{
+	if (m_depth > 0)
+	{
+		auto& top = m_levels[m_depth - 1];
+		if (top.map && top.state == State::Key)
+		{
+			top.key.assign(data, size);
+			top.state = State::PendingValue;
+			return false;
+		}
+	}
+
+	return scalar(emitter, hash(data, size));
+}
+
+YSL_IMPL_STORAGE bool detail::DeltaWriter::scalar(Emitter& emitter, std::uint64_t value_hash)
+{
+	if (m_depth == 0 || !m_levels[m_depth - 1].map)
+	{
+		m_dirty = true;
+		return true;
+	}
+
+	auto& top = m_levels[m_depth - 1];
+	switch (top.state)
+	{
+	case State::Key: // not a string
+	{
+		flush(emitter, false);
+		top.state = State::Value;
+		m_dirty   = true;
+		return true;
+	}
+	case State::PendingValue:
+	{
+		const auto path = hash(top.key.data(), top.key.size(), top.path);
+		const auto it   = m_frame->values.emplace(path, value_hash);
+		if (!it.second)
+		{
+			if (it.first->second == value_hash && !m_keyframe)
+			{
+				top.state = State::Key;
+				top.modifiers.clear();
+				top.key_modifiers = 0;
+				return false;
+			}
+
+			it.first->second = value_hash;
+		}
+
+		flush(emitter, true);
+		m_dirty = true;
+		return true;
+	}
+	default:
+	{
+		top.state = State::Key;
+		m_dirty   = true;
+		return true;
+	}
+	}
+}
+
+YSL_IMPL_STORAGE void detail::DeltaWriter::node(Emitter& emitter)
+{
+	m_dirty = true;
+	if (m_depth == 0 || !m_levels[m_depth - 1].map)
+	{
+		return;
+	}
+
+	auto& top = m_levels[m_depth - 1];
+	switch (top.state)
+	{
+	case State::Key: // not a string
+	{
+		flush(emitter, false);
+		top.state = State::Value;
+		break;
+	}
+	case State::PendingValue:
+	{
+		flush(emitter, true);
+		break;
+	}
+	default:
+	{
+		top.state = State::Key;
+		break;
+	}
+	}
+}
+
+YSL_IMPL_STORAGE bool detail::DeltaWriter::modifier(Modifier value)
+{
+	if (m_depth == 0 || !m_levels[m_depth - 1].map)
+	{
+		return false;
+	}
+
+	auto& top = m_levels[m_depth - 1];
+	top.modifiers.push_back(std::move(value));
+	if (top.state == State::Key)
+	{
+		++top.key_modifiers;
+	}
+	return true;
+}
+
+YSL_IMPL_STORAGE void detail::DeltaWriter::flush(Emitter& emitter, bool with_key)
+{
+	const auto write_key = [&emitter](Level& level) {
+		for (std::size_t i = 0; i < level.key_modifiers; ++i)
+		{
+			level.modifiers[i](emitter);
+		}
+		emitter << Key << level.key << Value;
+		for (std::size_t i = level.key_modifiers; i < level.modifiers.size(); ++i)
+		{
+			level.modifiers[i](emitter);
+		}
+		level.modifiers.clear();
+		level.key_modifiers = 0;
+		level.state         = State::Key;
+	};
+
+	for (std::size_t i = 1; i < m_depth; ++i)
+	{
+		auto& level = m_levels[i];
+		if (!level.written)
+		{
+			write_key(m_levels[i - 1]);
+			emitter << BeginMap;
+			level.written = true;
+		}
+	}
+	if (with_key)
+	{
+		write_key(m_levels[m_depth - 1]);
+	}
+}
+
+YSL_IMPL_STORAGE void detail::DeltaWriter::push(bool map, bool written, std::uint64_t path)
+{
+	if (m_depth == m_levels.size())
+	{
+		m_levels.emplace_back();
+	}
+
+	auto& level   = m_levels[m_depth++];
+	level.map     = map;
+	level.written = written;
+	level.state   = State::Key;
+	level.path    = path;
+	level.key.clear();
+	level.modifiers.clear();
+	level.key_modifiers = 0;
+}
+
+YSL_IMPL_STORAGE std::uint64_t detail::timer_ticks()
+{
+
+#ifdef YSL_TIMER_TSC
+
+	if (timer_clock().tsc)
+	{
+		return __rdtsc();
+	}
+
+#endif
+
+	return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+YSL_IMPL_STORAGE double detail::timer_tick_ns()
+{
+	return timer_clock().tick_ns;
+}
+
+YSL_IMPL_STORAGE ProfileScope::ProfileScope(const char* file, int line,
+											google::LogSeverity severity, const char* name)
+	: m_file(file)
+	, m_line(line)
+	, m_severity(severity)
+{
+	detail::thread_profile().enter(name, std::strlen(name));
+	m_start = detail::timer_ticks();
+}
+
+YSL_IMPL_STORAGE ProfileScope::ProfileScope(const char* file, int line,
+											google::LogSeverity severity,
+											const std::string& name)
+	: m_file(file)
+	, m_line(line)
+	, m_severity(severity)
+{
+	detail::thread_profile().enter(name.data(), name.size());
+	m_start = detail::timer_ticks();
+}
+
+YSL_IMPL_STORAGE ProfileScope::~ProfileScope()
+{
+	const auto elapsed = detail::timer_ticks() - m_start;
+	if (detail::thread_profile().exit(elapsed))
+	{
+		log(m_file, m_line, m_severity);
+	}
+}
+
+YSL_IMPL_STORAGE void ProfileScope::log(const char* file, int line, google::LogSeverity severity)
+{
+	StreamLogger logger(file, line, severity);
+	logger << ThreadFrame("Profile");
+	detail::thread_profile().emit(logger);
+}
+
+YSL_IMPL_STORAGE detail::QuantileEstimator::QuantileEstimator(double p) noexcept
+	: m_p(p)
+{
+	clear();
+}
+
+YSL_IMPL_STORAGE void detail::QuantileEstimator::add(double value, std::size_t count)
+{
+	// the first 5 samples are kept as the initial markers
+	if (count <= 5)
+	{
+		m_heights[count - 1] = value;
+		if (count == 5)
+		{
+			std::sort(m_heights, m_heights + 5);
+		}
+		return;
+	}
+
+	// cell of the sample, the extreme markers are extended
+	std::size_t k = 0;
+	if (value < m_heights[0])
+	{
+		m_heights[0] = value;
+	}
+	else if (value >= m_heights[4])
+	{
+		m_heights[4] = value;
+		k            = 3;
+	}
+	else
+	{
+		while (value >= m_heights[k + 1])
+		{
+			++k;
+		}
+	}
+
+	const double increments[5] = {0., m_p / 2., m_p, (1. + m_p) / 2., 1.};
+	for (std::size_t i = 0; i < 5; ++i)
+	{
+		m_positions[i] += i > k ? 1. : 0.;
+		m_desired[i] += increments[i];
+	}
+
+	// adjust the middle markers by piecewise-parabolic, or linear prediction
+	auto& q = m_heights;
+	auto& n = m_positions;
+	for (std::size_t i = 1; i < 4; ++i)
+	{
+		const double d = m_desired[i] - n[i];
+		if ((d >= 1. && n[i + 1] - n[i] > 1.) || (d <= -1. && n[i - 1] - n[i] < -1.))
+		{
+			const double s         = d > 0. ? 1. : -1.;
+			const double parabolic = q[i] + s / (n[i + 1] - n[i - 1]) *
+													((n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) /
+															 (n[i + 1] - n[i]) +
+													 (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) /
+															 (n[i] - n[i - 1]));
+			if (q[i - 1] < parabolic && parabolic < q[i + 1])
+			{
+				q[i] = parabolic;
+			}
+			else
+			{
+				const auto j = s > 0. ? i + 1 : i - 1;
+				q[i] += s * (q[j] - q[i]) / (n[j] - n[i]);
+			}
+			n[i] += s;
+		}
+	}
+}
+
+YSL_IMPL_STORAGE double detail::QuantileEstimator::value(std::size_t count) const
+{
+	if (count == 0)
+	{
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	if (count < 5) // nearest rank
+	{
+		double sorted[5];
+		std::copy(m_heights, m_heights + count, sorted);
+		std::sort(sorted, sorted + count);
+		return sorted[static_cast<std::size_t>(m_p * static_cast<double>(count - 1) + .5)];
+	}
+
+	return m_heights[2];
+}
+
+YSL_IMPL_STORAGE void detail::QuantileEstimator::clear() noexcept
+{
+	for (std::size_t i = 0; i < 5; ++i)
+	{
+		m_heights[i]   = 0.;
+		m_positions[i] = static_cast<double>(i);
+	}
+	m_desired[0] = 0.;
+	m_desired[1] = 2. * m_p;
+	m_desired[2] = 4. * m_p;
+	m_desired[3] = 2. + 2. * m_p;
+	m_desired[4] = 4.;
+}
+
+YSL_IMPL_STORAGE Statistics::Statistics() noexcept = default;
+
+YSL_IMPL_STORAGE void Statistics::add(double value)
+{
+	++m_count;
+	if (m_count == 1)
+	{
+		m_min = value;
+		m_max = value;
+	}
+	else
+	{
+		m_min = std::min(m_min, value);
+		m_max = std::max(m_max, value);
+	}
+
+	// Welford's algorithm
+	const double delta = value - m_mean;
+	m_mean += delta / static_cast<double>(m_count);
+	m_m2 += delta * (value - m_mean);
+
+	m_p50.add(value, m_count);
+	m_p90.add(value, m_count);
+	m_p99.add(value, m_count);
+}
+
+YSL_IMPL_STORAGE void Statistics::clear() noexcept
+{
+	m_count = 0;
+	m_min   = 0.;
+	m_max   = 0.;
+	m_mean  = 0.;
+	m_m2    = 0.;
+	m_p50.clear();
+	m_p90.clear();
+	m_p99.clear();
+}
+
+YSL_IMPL_STORAGE double Statistics::variance() const noexcept
+{
+	return m_count > 0 ? m_m2 / static_cast<double>(m_count)
+					   : std::numeric_limits<double>::quiet_NaN();
+}
+
+YSL_IMPL_STORAGE double Statistics::p50() const
+{
+	return m_p50.value(m_count);
+}
+
+YSL_IMPL_STORAGE double Statistics::p90() const
+{
+	return m_p90.value(m_count);
+}
+
+YSL_IMPL_STORAGE double Statistics::p99() const
+{
+	return m_p99.value(m_count);
+}
+
+YSL_IMPL_STORAGE Emitter& operator<<(Emitter& emitter, const Statistics& value)
+{
+	emitter << Flow << BeginMap;
+	emitter << Key << "count" << Value << value.count();
+	emitter << Key << "min" << Value << value.min();
+	emitter << Key << "max" << Value << value.max();
+	emitter << Key << "mean" << Value << value.mean();
+	emitter << Key << "variance" << Value << value.variance();
+	emitter << Key << "p50" << Value << value.p50();
+	emitter << Key << "p90" << Value << value.p90();
+	emitter << Key << "p99" << Value << value.p99();
+	return emitter << EndMap;
+}
+
+YSL_IMPL_STORAGE StatAggregator::StatAggregator(std::size_t period, std::size_t period_ms) noexcept
+	: m_period(period)
+	, m_period_ms(static_cast<std::chrono::milliseconds::rep>(period_ms))
+{}
+
+YSL_IMPL_STORAGE bool StatAggregator::add(double value)
+{
+	const bool timed = m_period_ms.count() > 0;
+	if (timed && m_statistics.count() == 0)
+	{
+		m_start = std::chrono::steady_clock::now();
+	}
+
+	m_statistics.add(value);
+	return m_statistics.count() >= m_period ||
+		   (timed && std::chrono::steady_clock::now() - m_start >= m_period_ms);
+}
+
+YSL_IMPL_STORAGE Statistics StatAggregator::flush()
+{
+	auto ret = m_statistics;
+	m_statistics.clear();
+	return ret;
+}
+
+YSL_IMPL_STORAGE Context::Context()
+	: m_state(detail::context_pool().acquire())
+{
+	m_state->id = detail::next_context_id();
+}
+
+YSL_IMPL_STORAGE Context::~Context()
+{
+	if (m_state != nullptr)
+	{
+		detail::publish_record(*m_state, false);
+		detail::context_pool().release(m_state);
+	}
+}
+
+YSL_IMPL_STORAGE Context::Context(Context&& xvalue) noexcept
+	: m_state(xvalue.m_state)
+{
+	xvalue.m_state = nullptr;
+}
+
+YSL_IMPL_STORAGE Context& Context::operator=(Context&& xvalue) noexcept
+{
+	std::swap(m_state, xvalue.m_state);
+	return *this;
+}
+
+YSL_IMPL_STORAGE bool Context::set_format(EMITTER_MANIP value)
+{
+	return detail::set_format(detail::checked_emitter(*m_state), value);
+}
+
+YSL_IMPL_STORAGE bool Context::set_format(LoggerFormat value, std::size_t n)
+{
+	return detail::set_format(detail::checked_emitter(*m_state), value, n);
+}
+
+YSL_IMPL_STORAGE std::size_t Context::frame_index() const
+{
+	return m_state->frame_index;
+}
+
+YSL_IMPL_STORAGE std::uint64_t Context::id() const
+{
+	return m_state != nullptr ? m_state->id : 0;
+}
+
+YSL_IMPL_STORAGE void Context::flush()
+{
+	if (m_state != nullptr && !m_state->record.empty())
+	{
+		detail::publish_record(*m_state, true);
+	}
+}
+
+YSL_IMPL_STORAGE Buffer::Buffer(std::size_t capacity)
+	: m_streambuf(m_data)
+	, m_stream(&m_streambuf)
+	, m_emitter((std::reference_wrapper<std::ostream>(m_stream))) // HINT: use UI
+{
+	m_data.reserve(capacity);
+}
+
+YSL_IMPL_STORAGE bool Buffer::set_format(EMITTER_MANIP value)
+{
+	return detail::set_format(m_emitter, value);
+}
+
+YSL_IMPL_STORAGE bool Buffer::set_format(LoggerFormat value, std::size_t n)
+{
+	return detail::set_format(m_emitter, value, n);
+}
+
+YSL_IMPL_STORAGE void Buffer::clear()
+{
+	// HINT: a new root after EndDoc is emitted without the "---" separator
+	m_emitter << EndDoc;
+	if (!m_emitter.good()) // unfinished payload
+	{
+		m_emitter.reconstruct();
+	}
+	m_data.clear();
+}
+
+YSL_IMPL_STORAGE StreamLogger::SkipEmptyLogMessage::~SkipEmptyLogMessage()
+{
+	if (empty_line())
+	{
+		YSL_IMPL_NS_ bypass_glog_flush();
+	}
+}
+
+YSL_IMPL_STORAGE bool StreamLogger::SkipEmptyLogMessage::empty_line() // const
+{
+	auto buf = static_cast<google::base_logging::LogStreamBuf*>(stream().rdbuf());
+	if (buf->pcount() == m_init_count)
+	{
+		return true;
+	}
+
+	auto impl_buf = static_cast<YSL_IMPL_NS_ FilterForwardOutStreamBuf*>(m_filter_buf);
+	if (buf->pcount() == m_init_count + 1 && impl_buf != nullptr && impl_buf->end_with_eol())
+	{
+		return true;
+	}
+
+	return false;
+}
+
+YSL_IMPL_STORAGE void StreamLogger::SkipEmptyLogMessage::reset()
+{
+	auto buf     = static_cast<google::base_logging::LogStreamBuf*>(stream().rdbuf());
+	m_init_count = buf->pcount();
+	detail::min_log_level(); // ensure min_log_level initialized
+}
+
+YSL_IMPL_STORAGE bool StreamLogger::set_thread_format(EMITTER_MANIP value)
+{
+	return detail::set_format(detail::thread_emitter(), value);
+}
+
+YSL_IMPL_STORAGE bool StreamLogger::set_thread_format(LoggerFormat value, std::size_t n)
+{
+	return detail::set_format(detail::thread_emitter(), value, n);
+}
+
+YSL_IMPL_STORAGE StreamLogger::~StreamLogger()
+{
+	if (m_deferred != nullptr)
+	{
+		m_deferred->~ReconstructorBase<Message>();
+	}
+	if (m_context->id > 0)
+	{
+		self() << Newline;
+		end_record_line();
+		if (m_context->record.size() >= YSL_CONTEXT_RECORD_SIZE)
+		{
+			detail::publish_record(*m_context, true);
+		}
+		return;
+	}
+	if (!m_message.inited()) // muted without message
+	{
+		return;
+	}
+
+	self() << Newline;
+	//	m_implicit_eol = true;
 	//	thread_emitter() << Newline;
 	m_message.try_destruct();
 	YSL_IMPL_NS_ restore_glog_state();
@@ -334,64 +1644,245 @@ YSL_IMPL_STORAGE StreamLogger::~StreamLogger()
 
 YSL_IMPL_STORAGE StreamLogger& StreamLogger::operator<<(EMITTER_MANIP value)
 {
+	if (m_muted)
+	{
+		if (value == EndDoc) // end of the rejected document
+		{
+			m_muted = false;
+			return *this;
+		}
+		if (value != BeginDoc)
+		{
+			return *this;
+		}
+		unmute();
+	}
+
+	if (value == BeginDoc || value == EndDoc) // end of the delta document
+	{
+		m_delta = nullptr;
+	}
+
 	m_implicit_eol = value != Newline;
-	thread_emitter() << value;
+	if (m_delta == nullptr || !m_delta->manip(context_emitter(), value))
+	{
+		context_emitter() << value;
+	}
+	if (value == EndDoc && m_context->id > 0)
+	{
+		publish_record(false);
+	}
 	return *this;
 }
 
 YSL_IMPL_STORAGE StreamLogger& StreamLogger::operator<<(const ThreadFrame& value)
 {
+	if (m_context->id > 0) // the previous document is complete
+	{
+		publish_record(false);
+	}
+
+	m_delta = nullptr;
+	if (!FrameFilter::accept(value.name))
+	{
+		++m_context->frame_index;
+		m_muted = true;
+		return *this;
+	}
+
+	unmute();
 	m_implicit_eol = false;
 
 	if (value.reset)
 	{
-		auto& emitter  = detail::thread_emitter();
+		auto& emitter  = detail::checked_emitter(*m_context);
 		m_implicit_eol = true;
 		emitter << EndDoc;
 		emitter.reconstruct();
 	}
 
-	auto&      stream = thread_stream();
-	const auto text   = std::string(" ")
+	const auto text = std::string(" ")
 							  .append(value.name)
 							  .append(": ")
-							  .append(std::to_string(detail::thread_frame_index()++))
+							  .append(std::to_string(m_context->frame_index++))
 							  .append(" ");
+	detail::write_frame_header(context_stream(), text, value.fill_width);
 
-	stream << "--- # ";
-	stream << std::setfill('-')
-		   << std::setw(static_cast<int>(
-					  std::max(text.size() + 1, value.fill_width + text.size() / 2)));
-	stream << text;
-	stream << std::setfill('-')
-		   << std::setw(std::max(1, static_cast<int>(value.fill_width - text.size() / 2)));
-	stream << ""
-		   << " # ";
+	self() << BeginDoc;
+	m_delta = detail::begin_delta_frame(*m_context, value.name);
+	return *this;
+}
+
+YSL_IMPL_STORAGE StreamLogger& StreamLogger::operator<<(const FrameSchema& value)
+{
+	if (m_context->id > 0) // the previous document is complete
+	{
+		publish_record(false);
+	}
+
+	m_delta = nullptr;
+	if (!FrameFilter::accept(value.name))
+	{
+		++m_context->frame_index;
+		m_muted = true;
+		return *this;
+	}
+
+	unmute();
+	auto&      schemas = m_context->frame_schemas;
+	const auto it      = schemas.find(value.name);
+	if (it == schemas.end() || it->second != value.keys)
+	{
+		schemas[value.name] = value.keys;
+
+		// schema document, in frame without index
+		m_implicit_eol = false;
+		detail::write_frame_header(
+				context_stream(), std::string(" ").append(value.name).append(" "),
+				value.fill_width);
+		self() << BeginDoc;
+		context_stream() << "!schema "; // HINT: yaml-cpp rejects LocalTag here
+		self() << Flow << BeginMap;
+		self() << Key << "keys" << Value << Flow << BeginSeq;
+		for (const auto& key : value.keys)
+		{
+			self() << key;
+		}
+		self() << EndSeq;
+		if (!value.types.empty())
+		{
+			self() << Key << "types" << Value << Flow << BeginSeq;
+			for (const auto& type : value.types)
+			{
+				self() << type;
+			}
+			self() << EndSeq;
+		}
+		self() << EndMap;
+
+		m_implicit_eol = true; // new message for the row
+		context_emitter() << Newline;
+	}
+
+	m_implicit_eol  = false;
+	const auto text = std::string(" ")
+							  .append(value.name)
+							  .append(": ")
+							  .append(std::to_string(m_context->frame_index++))
+							  .append(" ");
+	detail::write_frame_header(context_stream(), text, value.fill_width);
 
 	self() << BeginDoc;
+	context_stream() << "!row "; // HINT: see above
+	self() << Flow << BeginSeq;
 	return *this;
 }
 
 YSL_IMPL_STORAGE void StreamLogger::change_message()
 {
+	if (m_context->id > 0)
+	{
+		end_record_line();
+		reset();
+		return;
+	}
+
 	m_message->reconstruct();
 	YSL_IMPL_NS_ restore_glog_state();
 	reset();
 }
 
-YSL_IMPL_STORAGE Emitter& StreamLogger::thread_emitter()
+YSL_IMPL_STORAGE detail::ContextState* StreamLogger::context_state(Context* context)
+{
+	return context != nullptr && context->state() != nullptr ? context->state()
+															 : &detail::thread_context();
+}
+
+YSL_IMPL_STORAGE bool& StreamLogger::context_muted(detail::ContextState* context)
+{
+	return context->muted;
+}
+
+YSL_IMPL_STORAGE detail::DeltaWriter*& StreamLogger::context_delta(detail::ContextState* context)
+{
+	return context->delta;
+}
+
+YSL_IMPL_STORAGE Emitter& StreamLogger::context_emitter()
 {
-	return detail::thread_emitter();
+	return detail::checked_emitter(*m_context);
 }
 
-YSL_IMPL_STORAGE std::ostream& StreamLogger::thread_stream()
+YSL_IMPL_STORAGE std::ostream& StreamLogger::context_stream()
 {
-	return detail::thread_stream();
+	return *m_context->stream;
+}
+
+YSL_IMPL_STORAGE void StreamLogger::unmute()
+{
+	m_muted = false;
+	if (!m_message.inited() && m_deferred != nullptr)
+	{
+		m_message.construct_by(*m_deferred);
+		reset();
+	}
 }
 
 YSL_IMPL_STORAGE void StreamLogger::reset()
 {
-	detail::thread_stream().reset(this, m_message->stream());
+	auto& stream = detail::context_stream(*m_context);
+	if (m_context->id > 0)
+	{
+		stream.reset(this, m_context->record_stream);
+		m_context->line_begin = m_context->record.size();
+		return;
+	}
+
+	stream.reset(this, m_message->stream());
+	m_message->attach(stream.rdbuf());
+}
+
+YSL_IMPL_STORAGE bool StreamLogger::begin_record(const char* file, int line,
+												 google::LogSeverity severity)
+{
+	if (m_context->id == 0)
+	{
+		return false;
+	}
+
+	auto& statement    = m_context->statement;
+	statement.file     = file;
+	statement.line     = line;
+	statement.severity = severity;
+	if (m_context->record.empty())
+	{
+		m_context->head = m_context->statement;
+	}
+	reset();
+	return true;
+}
+
+YSL_IMPL_STORAGE void StreamLogger::end_record_line()
+{
+	auto&      record = m_context->record;
+	auto       buf    = static_cast<YSL_IMPL_NS_ FilterForwardOutStreamBuf*>(
+			   detail::context_stream(*m_context).rdbuf());
+	const auto size   = record.size() - m_context->line_begin;
+	if (size == 0 || (size == 1 && buf->end_with_eol()))
+	{
+		record.resize(m_context->line_begin);
+	}
+	else if (record.back() != '\n')
+	{
+		record.push_back('\n');
+	}
+	m_context->line_begin = record.size();
+}
+
+YSL_IMPL_STORAGE void StreamLogger::publish_record(bool continued)
+{
+	end_record_line();
+	detail::publish_record(*m_context, continued);
 }
 
 } // namespace YSL_NAMESPACE
@@ -1,11 +1,15 @@
 
 #include <cmath>
+#include <cstdlib>
 #include <map>
+#include <memory>
 #include <thread>
 #include <vector>
 
 #include "ysl.hpp"
 
+#include "eigen_emitter.hpp"
+#include "shm_sink.hpp"
 #include "stl_emitter.hpp"
 
 int main(int /*argc*/, char* argv[])
@@ -19,6 +23,15 @@ int main(int /*argc*/, char* argv[])
 
 	google::InitGoogleLogging(argv[0]);
 
+	// optional live shared memory sink, e.g. for BasicRenderer('shm:ysl_demo'),
+	// glog file/stderr output is kept
+	std::unique_ptr<YSL::SharedMemorySink> shm_sink;
+	if (const auto shm_name = std::getenv("YSL_SHM_SINK"))
+	{
+		shm_sink.reset(new YSL::SharedMemorySink(shm_name));
+		google::AddLogSink(shm_sink.get());
+	}
+
 	// setup YSL for current thread: use 4 sapces as indent
 	YSL::StreamLogger::set_thread_format(YSL::LoggerFormat::Indent, 4);
 
@@ -51,6 +64,22 @@ int main(int /*argc*/, char* argv[])
 		YSL(INFO) << YSL::EndMap << YSL::EndDoc;
 	}
 
+	// Eigen sparse objects from compressed storage, as !sparse:csr, !sparse:csc mappings
+	{
+		YSL_FSCOPE(INFO, "Eigen Sparse Objects");
+		Eigen::SparseMatrix<float, Eigen::RowMajor> csr(3, 4);
+		csr.insert(0, 1) = 1.5f;
+		csr.insert(2, 3) = -2.f;
+		csr.makeCompressed();
+		const Eigen::SparseMatrix<float> csc = csr;
+		Eigen::SparseVector<double>      vector(6);
+		vector.insert(1) = 0.25;
+		vector.insert(4) = 4.;
+		YSL(INFO) << "csr" << csr;
+		YSL(INFO) << "csc" << csc;
+		YSL(INFO) << "vector" << vector;
+	}
+
 	// comment, literal and implicit/explicit new line
 	{
 		YSL_FSCOPE(INFO, "About Comment, Literal And Newline");
@@ -76,6 +105,67 @@ int main(int /*argc*/, char* argv[])
 		VYSL_IF(1, loop & 3) << std::vector<int>(loop, loop);
 	}
 
+	// schema-declared frames, keys are logged once and each frame is a compact row
+	const YSL::FrameSchema schema("Schema Rows", {"loop", "square"});
+	for (int loop = 0; loop < 10; ++loop)
+	{
+		YSL_ROW(INFO, schema, loop, loop * loop);
+	}
+
+	// explicit context, which can be moved along with a task to another thread,
+	// its documents are published as glog records tagged with the context id
+	{
+		YSL::Context context;
+		YSL_CTX_FSCOPE(context, INFO, "Context Frame");
+		std::thread([&context]() { YSL_CTX(context, INFO) << "worker" << true; }).join();
+	}
+
+	// YAML payload captured without glog, the buffer can be reused after clear
+	{
+		YSL::Buffer buffer;
+		YSL_TO_BUFFER(buffer) << YSL::Flow << YSL::BeginMap << "status"
+							  << "ok" << YSL::EndMap;
+		LOGC(INFO) << "payload: " << buffer.str();
+		buffer.clear();
+	}
+
+	// online statistics, only a summary frame is logged every 100 samples
+	for (int loop = 0; loop < 300; ++loop)
+	{
+		YSL_STAT_EVERY(INFO, "Sine Stat", std::sin(loop * .1), 100, 0);
+	}
+
+	// timed frame logs "elapsed_ms" at the end, profiled scopes are aggregated per thread
+	{
+		YSL_TFSCOPE(INFO, "Timed Frame");
+		for (int loop = 0; loop < 3; ++loop)
+		{
+			YSL_PSCOPE(INFO, "loop");
+			YSL_PSCOPE(INFO, "sleep");
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		}
+	}
+	YSL_PROFILE(INFO);
+
+	// frame filter, usually from env YSL_FRAME_FILTER, rejected frames only advance the index
+	YSL::FrameFilter::set("-Filtered*");
+	{
+		YSL_FSCOPE(INFO, "Filtered Frame");
+		YSL(INFO) << "never formatted" << std::vector<int>(1000, 0);
+	}
+	YSL::FrameFilter::reload();
+
+	// delta frames, usually from env YSL_DELTA_FRAMES, only changed scalars are logged between
+	// keyframes, see resolve_delta in python/parsers.py
+	YSL::DeltaFrames::set("Delta*");
+	for (int loop = 0; loop < 3; ++loop)
+	{
+		YSL_FSCOPE(INFO, "Delta Frame");
+		YSL(INFO) << "config" << "constant";
+		YSL(INFO) << "loop" << loop;
+	}
+	YSL::DeltaFrames::reload();
+
 	// threaded logging
 	const int  n      = 4;
 	const int  m      = 1000;
@@ -115,5 +205,10 @@ int main(int /*argc*/, char* argv[])
 	}
 
 	LOG(INFO); // HINT: extra flush
+	if (shm_sink)
+	{
+		shm_sink->flush();
+		google::RemoveLogSink(shm_sink.get());
+	}
 	return 0;
 }
@@ -9,29 +9,20 @@ Created on Fri Sep 20 10:42:02 2019
 from __future__ import absolute_import, division, unicode_literals
 
 # import ysl.
-from backends import tailc
-from filters import thread_filter
-from glog_parser import GlogParser, get_msg
-from parsers import FrameParser, frame_parser
+from backends import followc
+from glog_parser import GlogParser
+from parsers import demux_frame_parser
 
 # setup source
-proc = tailc('/tmp/demo.log')
 glog_parser = GlogParser()
-record_stream = glog_parser.process(proc.stdout)
+record_stream = glog_parser.process(followc('/tmp/demo.log'))
+frame_stream = demux_frame_parser(record_stream, persistent=True)
 
 # select one thread to parse
 thread_id = None
-while True:
-    if thread_id is None:
-        for record in record_stream:
-            match = FrameParser.REGEX.fullmatch(record.msg)
-            if match:
-                frame = FrameParser.make_frame(*match.groups())
-                if frame.name.startswith('Thread'):
-                    thread_id = record.thread_id
-                    break
-    else:
-        record_stream = thread_filter(record_stream, thread_id)
+for thread_id_, frame, document in frame_stream:
+    if frame.name.startswith('Thread'):
+        thread_id = thread_id_
         break
 
 
@@ -39,29 +30,34 @@ while True:
 import time
 import matplotlib.pyplot as plt
 
+from renderer import SeriesStore
+
 
 plt.interactive(True)
 ax = plt.subplot(title=f'Thread {thread_id}')
+lines = dict()
 t1 = time.time()
-series = dict()
-msg_stream = get_msg(record_stream)
-frame_stream = frame_parser(msg_stream)
-for frame, document in frame_stream:
+series = SeriesStore(capacity=100)
+batch = []
+for thread_id_, frame, document in frame_stream:
+    if thread_id_ != thread_id:
+        continue
+
     print(frame.index, document)
-    for key, value in document.items():
-        data = series.setdefault(key, [])
-        data.append(value)
-        series[key] = data[-100:]
+    batch.append((frame, document))
     t2 = time.time()
     if t1 + 0.05 < t2:
-        ax.clear()
-        cnt = 0
-        for key, value in series.items():
-            ax.plot(value, label=key)
-            cnt += 1
-            if cnt >= 2:
-                break
-        ax.legend(loc='best')
+        series.extend(batch)
+        batch.clear()
+        for key in list(series)[:2]:
+            line = lines.get(key)
+            if line is None:
+                line, = ax.plot([], label=key)
+                lines[key] = line
+                ax.legend(loc='best')
+            line.set_data(series.index, series[key])
+        ax.relim()
+        ax.autoscale_view()
         t2 = time.time()
         plt.pause(max(0.01, t1 + 0.1 - t2))
         t1 = t2
@@ -1,5 +1,5 @@
 #! /bin/sh
 
-c++ --std=c++11 -Icpp cpp/ysl.cpp demo.cpp -o /tmp/demo -lglog -lyaml-cpp -lpthread
+c++ --std=c++11 -I/usr/include/eigen3 -Icpp cpp/ysl.cpp demo.cpp -o /tmp/demo -lglog -lyaml-cpp -lpthread -lrt
 
 /tmp/demo 2>&1 | tee /tmp/demo.log & PYTHONPATH=$PYTHONPATH:python python3 demo.py
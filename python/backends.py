@@ -8,9 +8,15 @@ Created on Sun Sep 15 22:09:46 2019
 
 from __future__ import absolute_import, division, unicode_literals
 
+import os, select, struct
+
+from collections import namedtuple
 from subprocess import Popen, PIPE
 
 
+shm_document = namedtuple('shm_document', ('thread_id', 'name', 'index', 'time_us', 'text'))
+
+
 def set_non_block(io:'io.IOBase')->'Any':
     """set io/file/fd non-blocking"""
 
@@ -48,6 +54,340 @@ def tailc(filename:str,
     return proc
 
 
+class Inotify(object):
+    """minimal ctypes binding of inotify(7)"""
+
+    IN_MODIFY      :int = 0x00000002
+    IN_ATTRIB      :int = 0x00000004
+    IN_MOVED_FROM  :int = 0x00000040
+    IN_MOVED_TO    :int = 0x00000080
+    IN_CREATE      :int = 0x00000100
+    IN_DELETE      :int = 0x00000200
+    IN_DELETE_SELF :int = 0x00000400
+    IN_MOVE_SELF   :int = 0x00000800
+
+    def __init__(self):
+        import ctypes, ctypes.util
+
+        self.ctypes = ctypes
+        self.libc = ctypes.CDLL(ctypes.util.find_library('c') or 'libc.so.6', use_errno=True)
+        self.fd = self.libc.inotify_init1(os.O_NONBLOCK | os.O_CLOEXEC)
+        if self.fd < 0:
+            raise OSError(ctypes.get_errno(), 'inotify_init1 failed')
+
+    def add_watch(self, path:str, mask:int)->int:
+        """add watch, -1 is returned on failure"""
+
+        return self.libc.inotify_add_watch(self.fd, os.fsencode(path), mask)
+
+    def rm_watch(self, wd:int):
+        """remove watch"""
+
+        if wd >= 0:
+            self.libc.inotify_rm_watch(self.fd, wd)
+
+    def wait(self, timeout:'Optional[float]'=None)->bool:
+        """wait and drain events, return whether any event arrived"""
+
+        readable, _, _ = select.select([self.fd], [], [], timeout)
+        try:
+            while os.read(self.fd, 1 << 12):
+                pass
+        except BlockingIOError:
+            pass
+        return bool(readable)
+
+    def close(self):
+        """close inotify instance"""
+
+        if self.fd >= 0:
+            os.close(self.fd)
+            self.fd = -1
+
+
+class FileFollower(object):
+    """
+    in-process `tail -F`, iterable as bytes blocks of up to `block_size`
+    appends are waited on inotify(polled every `interval` seconds if unavailable),
+    the file is reopened by name if rotated, and read from start again if truncated
+    if `from_start` is False, only new content is followed
+    """
+
+    def __init__(self, filename:str,
+                 from_start:bool=True,
+                 block_size:int=1 << 22,
+                 interval:float=1.):
+        self.filename = filename
+        self.block_size = block_size
+        self.interval = interval
+        self.closed = False
+        self.fd = None
+        self.inode = None
+        self.position = 0
+        self.file_wd = -1
+
+        try:
+            self.inotify = Inotify()
+        except (AttributeError, OSError):
+            self.inotify = None
+        if self.inotify:
+            mask = (Inotify.IN_CREATE | Inotify.IN_DELETE
+                    | Inotify.IN_MOVED_FROM | Inotify.IN_MOVED_TO)
+            self.inotify.add_watch(os.path.dirname(os.path.abspath(filename)), mask)
+
+        self.open(seek_end=not from_start)
+
+    def __iter__(self)->'Iterable[bytes]':
+        while not self.closed:
+            if self.fd is not None:
+                yield from self.read_blocks()
+            yield from self.check_file()
+            if self.inotify:
+                self.inotify.wait(self.interval)
+            else:
+                select.select([], [], [], self.interval)
+
+    def open(self, seek_end:bool=False)->bool:
+        """(re)open the file by name, return whether the file exists"""
+
+        try:
+            fd = os.open(self.filename, os.O_RDONLY | os.O_CLOEXEC)
+        except FileNotFoundError:
+            return False
+
+        self.close_file()
+        stat = os.fstat(fd)
+        self.fd = fd
+        self.inode = stat.st_dev, stat.st_ino
+        self.position = os.lseek(fd, 0, os.SEEK_END) if seek_end else 0
+        if self.inotify:
+            mask = (Inotify.IN_MODIFY | Inotify.IN_ATTRIB
+                    | Inotify.IN_DELETE_SELF | Inotify.IN_MOVE_SELF)
+            self.file_wd = self.inotify.add_watch(self.filename, mask)
+        return True
+
+    def read_blocks(self)->'Iterable[bytes]':
+        """read until EOF"""
+
+        while True:
+            block = os.read(self.fd, self.block_size)
+            if not block:
+                break
+
+            self.position += len(block)
+            yield block
+
+    def check_file(self)->'Iterable[bytes]':
+        """handle rotation and truncation, the rest of a rotated file is yielded"""
+
+        if self.fd is None:
+            self.open()
+            return
+
+        try:
+            stat = os.stat(self.filename)
+        except FileNotFoundError: # wait for the new file
+            return
+
+        if (stat.st_dev, stat.st_ino) != self.inode:
+            yield from self.read_blocks()
+            self.open()
+        elif stat.st_size < self.position:
+            self.position = os.lseek(self.fd, 0, os.SEEK_SET)
+
+    def close_file(self):
+        """close the followed file"""
+
+        if self.fd is not None:
+            if self.inotify:
+                self.inotify.rm_watch(self.file_wd)
+            os.close(self.fd)
+            self.fd = None
+            self.file_wd = -1
+
+    def close(self):
+        """stop following"""
+
+        self.closed = True
+        self.close_file()
+        if self.inotify:
+            self.inotify.close()
+
+
+def followf(filename:str,
+            **kwargs)->FileFollower:
+    """in-process tail follow"""
+
+    return FileFollower(filename, from_start=False, **kwargs)
+
+
+def followc(filename:str,
+            **kwargs)->FileFollower:
+    """in-process tail cat and follow"""
+
+    return FileFollower(filename, from_start=True, **kwargs)
+
+
+class SharedMemoryRing(object):
+    """
+    reader of the shared memory ring written by YSL::SharedMemorySink(cpp/shm_sink.hpp),
+    iterable as shm_document(thread_id, name, index, time_us, text) of complete documents,
+    thread_id is the negated context id for documents of a YSL::Context(see parsers),
+    the ring is polled every `interval` seconds if empty, and waited for if not created yet,
+    the reader restarts from the beginning if the writer restarts
+    if `from_start` is False, only new documents are followed
+    """
+
+    # magic, capacity, write position, read position, dropped, writer epoch
+    HEADER :struct.Struct = struct.Struct('<8sQQQQQ')
+    # size, kind, thread id, name size, frame index, time in us, text size, context id
+    RECORD :struct.Struct = struct.Struct('<IIIIqqII')
+    POSITION :struct.Struct = struct.Struct('<Q')
+    MAGIC         :bytes = b'YSLSHM01'
+    HEADER_SIZE   :int = 64
+    READ_OFFSET   :int = 24
+    KIND_DOCUMENT :int = 0
+    NO_INDEX      :int = -(1 << 63)
+
+    def __init__(self, name:str,
+                 from_start:bool=True,
+                 interval:float=1e-3,
+                 check_interval:float=1.):
+        self.path = os.path.join('/dev/shm', name.lstrip('/'))
+        self.from_start = from_start
+        self.interval = interval
+        self.check_interval = check_interval
+        self.closed = False
+        self.mmap = None
+        self.buf = None
+        self.inode = None
+        self.capacity = 0
+        self.epoch = None
+        self.position = 0
+        self.dropped = 0
+
+        self.open()
+
+    def __iter__(self)->'Iterable[shm_document]':
+        idle_time = 0.
+        while not self.closed:
+            documents = self.read_documents() if self.buf is not None else []
+            if documents:
+                idle_time = 0.
+                yield from documents
+                continue
+
+            if self.buf is None or idle_time >= self.check_interval:
+                idle_time = 0.
+                self.check_ring()
+            select.select([], [], [], self.interval)
+            idle_time += self.interval
+
+    def open(self)->bool:
+        """(re)map the ring by name, return whether the ring exists"""
+
+        import mmap
+
+        try:
+            fd = os.open(self.path, os.O_RDWR | os.O_CLOEXEC)
+        except FileNotFoundError:
+            return False
+
+        try:
+            stat = os.fstat(fd)
+            if stat.st_size < self.HEADER_SIZE: # being created
+                return False
+
+            mapped = mmap.mmap(fd, stat.st_size)
+        finally:
+            os.close(fd)
+
+        magic, capacity, write, _, _, epoch = self.HEADER.unpack_from(mapped)
+        if magic != self.MAGIC or self.HEADER_SIZE + capacity > stat.st_size:
+            mapped.close()
+            return False
+
+        self.close_ring()
+        self.mmap = mapped
+        self.buf = memoryview(mapped)
+        self.inode = stat.st_dev, stat.st_ino
+        self.capacity = capacity
+        self.epoch = epoch
+        self.position = 0 if self.from_start else write
+        self.from_start = True # HINT: a new ring is read from the beginning
+        return True
+
+    def check_ring(self):
+        """handle creation, recreation and resizing of the ring"""
+
+        try:
+            stat = os.stat(self.path)
+        except FileNotFoundError: # wait for the new ring
+            return
+
+        if (self.buf is None or (stat.st_dev, stat.st_ino) != self.inode
+                or self.HEADER.unpack_from(self.buf)[1] != self.capacity):
+            self.open()
+
+    def read_documents(self)->'List[shm_document]':
+        """read all published documents, then release their space to the writer"""
+
+        # HINT: the writer publishes the write position with release semantics
+        buf = self.buf
+        _, capacity, write, _, self.dropped, epoch = self.HEADER.unpack_from(buf)
+        if capacity != self.capacity:
+            return []
+
+        if epoch != self.epoch: # writer restarted
+            self.epoch = epoch
+            self.position = 0
+
+        ret = []
+        while self.position < write:
+            offset = self.position % capacity
+            tail = capacity - offset
+            if tail < self.RECORD.size: # implicit padding
+                self.position += tail
+                continue
+
+            offset += self.HEADER_SIZE
+            (size, kind, thread_id, name_size, index, time_us, text_size, context_id) = \
+                    self.RECORD.unpack_from(buf, offset)
+            if kind == self.KIND_DOCUMENT:
+                offset += self.RECORD.size
+                name = bytes(buf[offset:offset + name_size]).decode(errors='replace')
+                offset += name_size
+                text = bytes(buf[offset:offset + text_size]).decode(errors='replace')
+                index = None if index == self.NO_INDEX else index
+                thread_id = -context_id if context_id else thread_id
+                ret.append(shm_document(thread_id, name, index, time_us, text))
+            self.position += size
+
+        self.POSITION.pack_into(buf, self.READ_OFFSET, self.position)
+        return ret
+
+    def close_ring(self):
+        """unmap the ring"""
+
+        if self.mmap is not None:
+            self.buf.release()
+            self.mmap.close()
+            self.mmap = self.buf = None
+
+    def close(self):
+        """stop following"""
+
+        self.closed = True
+        self.close_ring()
+
+
+def shm_followc(name:str,
+                **kwargs)->SharedMemoryRing:
+    """follow all documents of the shared memory ring `name`"""
+
+    return SharedMemoryRing(name, from_start=True, **kwargs)
+
+
 def ssh_tailc(address:str, filename:str,
               **kwargs)->Popen:
     """tail cat and follow via ssh"""
@@ -58,6 +398,5 @@ def ssh_tailc(address:str, filename:str,
 
 
 if __name__ == '__main__':
-    proc = tailc('/tmp/test.log')
-    for line in proc.stdout:
-        print(line)
+    for block in followc('/tmp/test.log'):
+        print(block)
@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Created on Mon Oct 19 01:02:37 2026
+
+@author: agent
+"""
+
+from __future__ import absolute_import, division, unicode_literals
+
+import logging, os
+import numpy as np
+
+from collections.abc import Mapping
+from urllib.parse import quote, unquote
+
+
+logger = logging.getLogger(__name__)
+
+INDEX_KEY     :str = '#index'     # frame index column
+TIMESTAMP_KEY :str = '#timestamp' # frame header date column, datetime64[us]
+MASK_PREFIX   :str = '#mask:'     # mask of a column with missing values, True if missing
+
+
+def flatten_document(
+        document:'Any',
+        prefix:str='')->'Iterable[Tuple[str, Any]]':
+    """flatten nested mappings in `document` into (key path, value), e.g. ('pose.x', 1.)"""
+
+    if not isinstance(document, Mapping):
+        yield prefix, document
+        return
+
+    for key, value in document.items():
+        key = str(key)
+        path = prefix + '.' + key if prefix else key
+        if isinstance(value, Mapping) and value:
+            yield from flatten_document(value, path)
+        else:
+            yield path, value
+
+
+def dtype_of(value:'Any')->np.dtype:
+    """column dtype for `value`, object for non-scalars"""
+
+    if isinstance(value, (bool, np.bool_)):
+        return np.dtype(np.bool_)
+    if isinstance(value, int) and -(1 << 63) <= value < (1 << 63):
+        return np.dtype(np.int64)
+    if isinstance(value, float):
+        return np.dtype(np.float64)
+    if isinstance(value, complex):
+        return np.dtype(np.complex128)
+    if isinstance(value, np.generic) and value.dtype.kind in 'biufcmM':
+        return value.dtype
+    return np.dtype(object)
+
+
+def promote_dtype(dtype:np.dtype, other:np.dtype)->np.dtype:
+    """common dtype of two columns, numeric types are promoted, otherwise object"""
+
+    if dtype == other:
+        return dtype
+    if dtype.kind in 'biufc' and other.kind in 'biufc':
+        return np.promote_types(dtype, other)
+    return np.dtype(object)
+
+
+def blank(size:int, dtype:np.dtype)->np.ndarray:
+    """array of missing values: NaT for datetime, None for object, zeros otherwise"""
+
+    if dtype.kind in 'mM':
+        return np.full(size, 'NaT', dtype=dtype)
+    if dtype.kind == 'O':
+        return np.full(size, None, dtype=dtype)
+    return np.zeros(size, dtype=dtype)
+
+
+class Column(object):
+    """
+    typed column grown in preallocated chunks of `chunk_size` rows,
+    rows never set are missing
+    """
+
+    def __init__(self, dtype:np.dtype, chunk_size:int):
+        self.dtype = dtype
+        self.chunk_size = chunk_size
+        self.chunks = [] # [(data, mask)]
+
+    def __setitem__(self, row:int, value:'Any'):
+        dtype = dtype_of(value)
+        if dtype != self.dtype:
+            dtype = promote_dtype(self.dtype, dtype)
+            if dtype != self.dtype: # e.g. not for an int in a float column
+                self.astype(dtype)
+
+        chunk, offset = divmod(row, self.chunk_size)
+        while len(self.chunks) <= chunk:
+            data = blank(self.chunk_size, self.dtype)
+            mask = np.ones(self.chunk_size, dtype=np.bool_)
+            self.chunks.append((data, mask))
+        data, mask = self.chunks[chunk]
+        data[offset] = value
+        mask[offset] = False
+
+    def astype(self, dtype:np.dtype):
+        """convert stored chunks to `dtype`"""
+
+        self.dtype = dtype
+        self.chunks = [(data.astype(dtype), mask) for data, mask in self.chunks]
+
+    def finish(self, num_rows:int)->'Tuple[np.ndarray, Optional[np.ndarray]]':
+        """return (data, mask) of `num_rows`, mask is None if no value is missing"""
+
+        if self.chunks:
+            data = np.concatenate([data for data, _ in self.chunks])[:num_rows]
+            mask = np.concatenate([mask for _, mask in self.chunks])[:num_rows]
+        else:
+            data = blank(0, self.dtype)
+            mask = np.zeros(0, dtype=np.bool_)
+        if len(data) < num_rows:
+            data = np.concatenate([data, blank(num_rows - len(data), self.dtype)])
+            mask = np.concatenate([mask, np.ones(num_rows - len(mask), dtype=np.bool_)])
+        return data, (mask if mask.any() else None)
+
+
+class FrameColumns(object):
+    """
+    columnar builder of documents in frames named `name`(all frames if None),
+    one column per flattened key path, plus INDEX_KEY and TIMESTAMP_KEY columns,
+    missing values are masked with MASK_PREFIX + key
+    """
+
+    def __init__(self,
+                 name:'Optional[str]'=None,
+                 chunk_size:int=1 << 16):
+        self.name = name
+        self.chunk_size = chunk_size
+        self.num_rows = 0
+        self.columns = dict()
+        self.index = Column(np.dtype(np.int64), chunk_size)
+        self.timestamp = Column(np.dtype('datetime64[us]'), chunk_size)
+
+    def __len__(self)->int:
+        return self.num_rows
+
+    def append(self, frame:'frame', document:'Any',
+               date:'Any'=None)->bool:
+        """append a document, return False if the frame is not selected"""
+
+        if self.name is not None and frame.name != self.name:
+            return False
+
+        row = self.num_rows
+        self.num_rows += 1
+        if frame.index is not None:
+            self.index[row] = frame.index
+        if date is not None:
+            from glog_parser import decode_date
+
+            self.timestamp[row] = np.datetime64(decode_date(date), 'us')
+        for key, value in flatten_document(document):
+            if value is None:
+                continue
+
+            column = self.columns.get(key)
+            if column is None:
+                column = self.columns[key] = Column(dtype_of(value), self.chunk_size)
+            column[row] = value
+        return True
+
+    def extend(self, frame_stream:'Iterable[Tuple[Any, ...]]')->'FrameColumns':
+        """append each (frame, document) or (frame, document, date) in `frame_stream`"""
+
+        for item in frame_stream:
+            self.append(*item)
+        return self
+
+    def arrays(self)->'Mapping[str, np.ndarray]':
+        """all columns and masks as flat arrays"""
+
+        ret = dict()
+        for key, column in ((INDEX_KEY, self.index), (TIMESTAMP_KEY, self.timestamp),
+                            *self.columns.items()):
+            data, mask = column.finish(self.num_rows)
+            ret[key] = data
+            if mask is not None:
+                ret[MASK_PREFIX + key] = mask
+        return ret
+
+    def save(self, path:str,
+             compressed:bool=False):
+        """save to `path`, see save_columns"""
+
+        save_columns(path, self.arrays(), compressed=compressed)
+
+
+def frame_columns(
+        frame_stream:'Iterable[Tuple[Any, ...]]',
+        name:'Optional[str]'=None,
+        chunk_size:int=1 << 16)->'Mapping[str, np.ndarray]':
+    """
+    build columns of frames named `name` from `frame_stream`
+    of (frame, document) or (frame, document, date), see FrameColumns
+    """
+
+    return FrameColumns(name, chunk_size=chunk_size).extend(frame_stream).arrays()
+
+
+def save_columns(path:str, arrays:'Mapping[str, np.ndarray]',
+                 compressed:bool=False):
+    """
+    save `arrays` to `path`, a .npz file if it ends with '.npz',
+    otherwise a directory of .npy files to be memory-mapped by load_columns
+    """
+
+    if path.endswith('.npz'):
+        savez = np.savez_compressed if compressed else np.savez
+        savez(path, **arrays)
+        return
+
+    os.makedirs(path, exist_ok=True)
+    for key, array in arrays.items():
+        np.save(os.path.join(path, quote(key, safe='') + '.npy'), array)
+
+
+def load_columns(path:str,
+                 mmap_mode:'Optional[str]'='r',
+                 masked:bool=True)->'Mapping[str, np.ndarray]':
+    """
+    load columns saved by save_columns, .npy files are memory-mapped with `mmap_mode`,
+    columns with masks are returned as numpy.ma.MaskedArray if `masked`,
+    object columns are unpickled
+    """
+
+    if path.endswith('.npz'):
+        with np.load(path, allow_pickle=True) as npz:
+            arrays = {key: npz[key] for key in npz.files}
+    else:
+        arrays = dict()
+        for filename in sorted(os.listdir(path)):
+            if filename.endswith('.npy'):
+                key = unquote(filename[:-len('.npy')])
+                filepath = os.path.join(path, filename)
+                try:
+                    arrays[key] = np.load(filepath, mmap_mode=mmap_mode)
+                except ValueError: # object arrays can not be memory-mapped
+                    arrays[key] = np.load(filepath, allow_pickle=True)
+
+    if not masked:
+        return arrays
+
+    ret = dict()
+    for key, array in arrays.items():
+        if key.startswith(MASK_PREFIX):
+            continue
+
+        mask = arrays.get(MASK_PREFIX + key)
+        ret[key] = array if mask is None else np.ma.MaskedArray(array, mask=mask)
+    return ret
+
+
+def export_log(log_path:str, name:str, path:str,
+               compressed:bool=False,
+               chunk_size:int=1 << 16)->int:
+    """
+    export frames named `name` in the glog file to `path`, see save_columns,
+    threads are parsed separately, return number of frames exported
+    """
+
+    from filters import thread_filter
+    from glog_parser import GlogParser
+    from parsers import FrameParser, timed_frame_parser
+
+    with open(log_path, 'rb') as f:
+        records = list(GlogParser(hold_last=False).parse(f.read()))
+    thread_ids = []
+    for record in records:
+        match = FrameParser.REGEX.fullmatch(record.msg)
+        if match and record.thread_id not in thread_ids:
+            if FrameParser.make_frame(*match.groups()).name == name:
+                thread_ids.append(record.thread_id)
+
+    columns = FrameColumns(name, chunk_size=chunk_size)
+    for thread_id in thread_ids:
+        columns.extend(timed_frame_parser(thread_filter(records, thread_id), persistent=True))
+    columns.save(path, compressed=compressed)
+    logger.info('%d frames of %s, %d columns exported to %s',
+                len(columns), name, len(columns.columns), path)
+    return len(columns)
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser(
+            description='export YSL frames in a glog file to columnar NumPy arrays')
+    parser.add_argument('log_path', help='path to the glog file')
+    parser.add_argument('name', help='frame name, e.g. "Thread 0"')
+    parser.add_argument('output', help='output .npz file, or directory of .npy files')
+    parser.add_argument('--compressed', action='store_true', help='compress .npz')
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO)
+    export_log(args.log_path, args.name, args.output, compressed=args.compressed)
+    for key, array in load_columns(args.output).items():
+        print(f'{key}: {array.dtype}{array.shape}')
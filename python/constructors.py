@@ -10,6 +10,7 @@ from __future__ import absolute_import, division, unicode_literals
 
 import yaml
 
+from collections import namedtuple
 from yaml import Node
 from yaml.constructor import BaseConstructor, FullConstructor, SafeConstructor
 
@@ -33,6 +34,23 @@ class LogLoader(
         yaml.resolver.Resolver.__init__(self)
 
 
+if yaml.__with_libyaml__:
+
+    class CLogLoader(yaml.cyaml.CParser, LogConstructor, yaml.resolver.Resolver):
+        """yaml loader for YSL, parsed with libyaml"""
+
+        def __init__(self, stream):
+            yaml.cyaml.CParser.__init__(self, stream)
+            LogConstructor.__init__(self)
+            yaml.resolver.Resolver.__init__(self)
+
+    DefaultLogLoader :type = CLogLoader
+
+else:
+    CLogLoader :'Optional[type]' = None
+    DefaultLogLoader :type = LogLoader
+
+
 # @dataclass
 class Generic(object):
     """
@@ -74,7 +92,86 @@ def construct_tensor(
         tensor_cls:type=list)->'Any':
     """construct tensor scalar"""
 
-    return tensor_cls(yaml.load(constructor.construct_scalar(node), Loader=LogLoader))
+    return tensor_cls(yaml.load(constructor.construct_scalar(node), Loader=DefaultLogLoader))
+
+
+def construct_binary_tensor(
+        constructor:BaseConstructor, tag_suffix:str, node:Node)->'numpy.ndarray':
+    """
+    construct binary tensor scalar tagged !tensor:<dtype>:<shape>, e.g. !tensor:f4:3x4,
+    base64 of raw little-endian data is decoded without copy as read-only numpy.ndarray
+    """
+
+    import base64
+    import numpy as np
+
+    dtype, _, shape = tag_suffix.partition(':')
+    shape = tuple(map(int, shape.split('x'))) if shape else ()
+    data = base64.b64decode(constructor.construct_scalar(node))
+    return np.frombuffer(data, dtype=np.dtype(dtype).newbyteorder('<')).reshape(shape)
+
+
+def construct_sparse(
+        constructor:BaseConstructor, tag_suffix:str, node:Node)->'Any':
+    """
+    construct sparse matrix mapping tagged !sparse:<format>, format in csr, csc or coo,
+    with shape, nnz, dtype(optional), indptr, indices, data or row, col, data arrays,
+    scipy.sparse matrix is returned if SciPy is available, otherwise the mapping with 'format'
+    """
+
+    ret = constructor.construct_mapping(node, deep=True)
+    ret['format'] = tag_suffix
+    try:
+        import numpy as np
+        import scipy.sparse as sp
+    except ImportError:
+        return ret
+
+    shape = tuple(ret['shape'])
+    data = np.asarray(ret['data'], dtype=ret.get('dtype'))
+    if tag_suffix == 'coo':
+        return sp.coo_matrix((data, (np.asarray(ret['row']), np.asarray(ret['col']))),
+                             shape=shape)
+
+    matrix_cls = {'csr': sp.csr_matrix, 'csc': sp.csc_matrix}[tag_suffix]
+    return matrix_cls((data, np.asarray(ret['indices']), np.asarray(ret['indptr'])),
+                      shape=shape)
+
+
+class FrameSchema(namedtuple('FrameSchema', ('keys', 'types'))):
+    """!schema document declared by YSL::FrameSchema, types may be empty"""
+
+    __slots__ = ()
+
+
+class SchemaRow(list):
+    """!row document of values in the order of FrameSchema.keys"""
+
+
+class DeltaDocument(dict):
+    """!delta document of YSL::DeltaFrames, with only the entries changed since the last frame"""
+
+
+def construct_frame_schema(
+        constructor:BaseConstructor, node:Node)->FrameSchema:
+    """construct frame schema mapping"""
+
+    ret = constructor.construct_mapping(node, deep=True)
+    return FrameSchema(tuple(map(str, ret['keys'])), tuple(ret.get('types') or ()))
+
+
+def construct_schema_row(
+        constructor:BaseConstructor, node:Node)->SchemaRow:
+    """construct schema row sequence"""
+
+    return SchemaRow(constructor.construct_sequence(node, deep=True))
+
+
+def construct_delta_document(
+        constructor:BaseConstructor, node:Node)->DeltaDocument:
+    """construct delta document mapping"""
+
+    return DeltaDocument(constructor.construct_mapping(node, deep=True))
 
 
 def construct_pb_message(
@@ -83,7 +180,7 @@ def construct_pb_message(
     """construct protobuf message scalar"""
 
     ret = constructor.construct_scalar(node)
-    ret = ret[1:-1] # remove extra {}
+    ret = ret.strip()[1:-1] # remove extra {}
     if message_cls is None:
         from quick_prototxt import load_prototxt
 
@@ -94,23 +191,28 @@ def construct_pb_message(
         return text_format.Parse(ret, message_cls())
 
 
+LogConstructor.add_multi_constructor('!tensor:', construct_binary_tensor) # before '!'
+LogConstructor.add_multi_constructor('!sparse:', construct_sparse) # before '!'
 LogConstructor.add_multi_constructor('!', multi_construct_generic)
 LogConstructor.add_constructor('!complex', FullConstructor.construct_python_complex)
 LogConstructor.add_constructor('!path', construct_path)
 LogConstructor.add_constructor('!tensor', construct_tensor)
+LogConstructor.add_constructor('!schema', construct_frame_schema)
+LogConstructor.add_constructor('!row', construct_schema_row)
+LogConstructor.add_constructor('!delta', construct_delta_document)
 LogConstructor.add_constructor('!pb2_message', construct_pb_message)
 LogConstructor.add_constructor('!pb3_message', construct_pb_message)
 
 if __name__ == '__main__':
     s = 'Complex: !complex 1+2j'
-    print(yaml.load(s, Loader=LogLoader))
+    print(yaml.load(s, Loader=DefaultLogLoader))
 
     s = ('MatExpr: !tensor |\n'
          '  [[[0, 0, 0], [0, 0, 0], [0, 0, 0]],\n'
          '   [[0, 0, 0], [0, 0, 0], [0, 0, 0]],\n'
          '   [[0, 0, 0], [0, 0, 0], [0, 0, 0]]]\n'
          )
-    print(yaml.load(s, Loader=LogLoader))
+    print(yaml.load(s, Loader=DefaultLogLoader))
 
     s = ('matrix:\n'
          '  - [1, 0, 0, 0, 0, 0, 0, 0]\n'
@@ -122,4 +224,4 @@ if __name__ == '__main__':
          '  - [0, 0, 0, 0, 0, 0, 1, 0]\n'
          '  - [0, 0, 0, 0, 0, 0, 0, 1]\n'
          )
-    print(yaml.load(s, Loader=LogLoader))
+    print(yaml.load(s, Loader=DefaultLogLoader))
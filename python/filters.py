@@ -17,14 +17,94 @@ def is_listy(obj:'Any')->bool:
     return isinstance(obj, (tuple, list, set))
 
 
+class RecordFilter(object):
+    """
+    conjunction of level, thread and filename filters declared up front,
+    can be pushed down into GlogParser(record_filter=...) so that non-matching records are
+    skipped at the head scanning before any record is made,
+    or called on a record as a predicate
+    levels are kept as a bitmask, thread_ids as a set, filename matches are memorized
+    """
+
+    ALL_LEVELS :int = 0b1111
+
+    def __init__(self,
+                 level:'Optional[Union[int, Sequence[int]]]'=None,
+                 thread:'Optional[Union[int, Sequence[int]]]'=None,
+                 filename_pattern:'Optional[str]'=None):
+        self.level_mask = self.ALL_LEVELS
+        self.thread_ids = None
+        self.filename_regexes = []
+        self.filename_memo = dict()
+        if level is not None:
+            self.add_level(level)
+        if thread is not None:
+            self.add_thread(thread)
+        if filename_pattern is not None:
+            self.add_filename(filename_pattern)
+
+    def __call__(self, record:'record')->bool:
+        return (self.accept_head(record.level, record.thread_id)
+                and self.accept_filename(record.filename))
+
+    def add_level(self, level:'Union[int, Sequence[int]]'):
+        """and level in `level`"""
+
+        levels = level if is_listy(level) else (level, )
+        mask = 0
+        for level in map(int, levels):
+            if 0 <= level < 4:
+                mask |= 1 << level
+        self.level_mask &= mask
+
+    def add_thread(self, thread:'Union[int, Sequence[int]]'):
+        """and thread_id in `thread`"""
+
+        thread_ids = thread if is_listy(thread) else (thread, )
+        thread_ids = frozenset(map(int, thread_ids))
+        self.thread_ids = thread_ids if self.thread_ids is None else self.thread_ids & thread_ids
+
+    def add_filename(self, filename_pattern:str):
+        """and filename fullmatches `filename_pattern`"""
+
+        self.filename_regexes.append(re.compile(filename_pattern))
+        self.filename_memo.clear()
+
+    def add(self, filter_name:str, *args)->bool:
+        """and filter by name in {'level', 'thread', 'filename'}, False if not supported"""
+
+        adder = getattr(self, 'add_' + filter_name, None)
+        if adder is None:
+            return False
+
+        adder(*args)
+        return True
+
+    def accept_head(self, level:int, thread_id:int)->bool:
+        """whether level and thread_id are accepted"""
+
+        return bool((self.level_mask >> level) & 1) and (
+                self.thread_ids is None or thread_id in self.thread_ids)
+
+    def accept_filename(self, filename:str)->bool:
+        """whether filename is accepted"""
+
+        if not self.filename_regexes:
+            return True
+
+        ret = self.filename_memo.get(filename)
+        if ret is None:
+            ret = self.filename_memo[filename] = all(
+                    regex.fullmatch(filename) for regex in self.filename_regexes)
+        return ret
+
+
 def level_filter(
         record_stream:'Iterable[record]',
         level:'Union[int, Sequence[int]]')->'Iterable[record]':
     """filter record by level"""
 
-    levels = level if is_listy(level) else (level, )
-    levels = list(map(int, levels))
-    return filter(lambda record: record.level in levels, record_stream)
+    return filter(RecordFilter(level=level), record_stream)
 
 
 def thread_filter(
@@ -32,14 +112,11 @@ def thread_filter(
         thread:'Union[int, Sequence[int]]')->'Iterable[record]':
     """filter record by thread_id"""
 
-    thread_ids = thread if is_listy(thread) else (thread, )
-    thread_ids = list(map(int, thread_ids))
-    return filter(lambda record: record.thread_id in thread_ids, record_stream)
+    return filter(RecordFilter(thread=thread), record_stream)
 
 
 def filename_filter(
         record_stream:'Iterable[record]', filename_pattern:str)->'Iterable[record]':
     """filter record by filename pattern"""
 
-    regex = re.compile(filename_pattern)
-    return filter(lambda record: regex.fullmatch(record.filename), record_stream)
+    return filter(RecordFilter(filename_pattern=filename_pattern), record_stream)
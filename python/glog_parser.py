@@ -8,7 +8,7 @@ Created on Mon Sep 16 13:36:20 2019
 
 from __future__ import absolute_import, division, unicode_literals
 
-import re
+import os, re
 
 from collections import namedtuple
 from datetime import datetime
@@ -19,8 +19,84 @@ GLOG_HEAD_PATTEN = r'([IWEF])(\d{4}\s+\d\d:\d\d:\d\d\.\d{6})\s+(\d+)\s+(\w+\.\w+
 GLOG_PERROR_PATTEN = r'C(ould not create log|OULD NOT CREATE LOG).+\n'
 GLOG_HEAD_REGEX = re.compile(GLOG_HEAD_PATTEN)
 GLOG_PERROR_REGEX = re.compile(GLOG_PERROR_PATTEN)
+GLOG_HEAD_BYTES_REGEX = re.compile(GLOG_HEAD_PATTEN.encode('utf-8'))
+GLOG_PERROR_BYTES_REGEX = re.compile(GLOG_PERROR_PATTEN.encode('utf-8'))
+GLOG_DATE_FORMAT :str = '%m%d %H:%M:%S.%f'
 
-record :type = namedtuple('record', GLOG_HEAD_GROUP_NAME)
+GLOG_SCANNER_LIBRARY :str = 'libglog_scanner.so' # built from glog_scanner.cpp
+
+
+
+def decode_date(date:'Union[datetime, str, bytes, Tuple[int, ...]]')->datetime:
+    """decode raw date from the record head"""
+
+    if isinstance(date, datetime):
+        return date
+
+    if isinstance(date, tuple): # fields from the native scanner
+        return datetime(1900, *date)
+
+    if isinstance(date, bytes):
+        date = date.decode('utf-8')
+    return datetime.strptime(date, GLOG_DATE_FORMAT)
+
+
+class record(namedtuple('record', GLOG_HEAD_GROUP_NAME)):
+    """
+    glog record, the date is decoded on the first access and cached,
+    field access, indexing, unpacking, comparison, _asdict() and _replace() see the datetime,
+    .raw_date is the raw date of the record head(see decode_date)
+    """
+
+    @property
+    def raw_date(self)->'Union[datetime, bytes, Tuple[int, ...]]':
+        return tuple.__getitem__(self, 1)
+
+    @property
+    def date(self)->datetime:
+        try:
+            return self._date
+        except AttributeError:
+            self._date = decode_date(self.raw_date)
+            return self._date
+
+    def __getitem__(self, index:'Union[int, slice]')->'Any':
+        if isinstance(index, slice):
+            return tuple(self)[index]
+
+        if index in (1, 1 - len(self)):
+            return self.date
+
+        return tuple.__getitem__(self, index)
+
+    def __iter__(self)->'Iterator[Any]':
+        yield tuple.__getitem__(self, 0)
+        yield self.date
+        yield from tuple.__getitem__(self, slice(2, None))
+
+    def __eq__(self, other:'Any')->bool:
+        return tuple(self) == other
+
+    def __ne__(self, other:'Any')->bool:
+        return tuple(self) != other
+
+    def __lt__(self, other:'Any')->bool:
+        return tuple(self) < other
+
+    def __le__(self, other:'Any')->bool:
+        return tuple(self) <= other
+
+    def __gt__(self, other:'Any')->bool:
+        return tuple(self) > other
+
+    def __ge__(self, other:'Any')->bool:
+        return tuple(self) >= other
+
+    def __hash__(self)->int:
+        return hash(tuple(self))
+
+    def __repr__(self):
+        return super(record, self._make(self)).__repr__() # HINT: with the decoded date
 
 
 def get_msg(record_stream:"Iterable[record]")->"Iterable[str]":
@@ -29,43 +105,119 @@ def get_msg(record_stream:"Iterable[record]")->"Iterable[str]":
     return map(lambda rec: rec.msg, record_stream)
 
 
+class NativeScanner(object):
+    """
+    ctypes binding of the native scanner in glog_scanner.cpp
+    record heads are scanned in batches of `batch_size`
+    """
+
+    def __init__(self, path:str,
+                 batch_size:int=4096):
+        import ctypes
+
+        lib = ctypes.CDLL(path)
+        lib.ysl_glog_head_fields.restype = ctypes.c_size_t
+        lib.ysl_glog_strip_perror.restype = ctypes.c_size_t
+        lib.ysl_glog_strip_perror.argtypes = (
+                ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p)
+        lib.ysl_glog_scan_heads.restype = ctypes.c_size_t
+        lib.ysl_glog_scan_heads.argtypes = (
+                ctypes.c_void_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t),
+                ctypes.c_void_p, ctypes.c_size_t)
+
+        self.ctypes = ctypes
+        self.lib = lib
+        self.num_fields = lib.ysl_glog_head_fields()
+        self.batch_size = batch_size
+        self.heads = (ctypes.c_int64 * (self.num_fields * batch_size))()
+
+    def strip(self, buffer:bytes)->bytearray:
+        """remove GLOG_PERROR_PATTEN from `buffer`"""
+
+        buffer = bytearray(buffer)
+        if buffer:
+            address = self.ctypes.addressof(self.ctypes.c_char.from_buffer(buffer))
+            del buffer[self.lib.ysl_glog_strip_perror(address, len(buffer), address):]
+        return buffer
+
+    def scan(self, buffer:bytearray)->'Iterable[Iterable[Tuple[int, ...]]]':
+        """
+        scan record heads in `buffer`, yield batches of heads as
+        (begin, end, level, month, day, hour, minute, second, microsecond,
+         thread_id, filename_begin, filename_end, line)
+        """
+
+        if not buffer:
+            return
+
+        ctypes = self.ctypes
+        address = ctypes.addressof(ctypes.c_char.from_buffer(buffer))
+        offset = ctypes.c_size_t(0)
+        while True:
+            count = self.lib.ysl_glog_scan_heads(
+                    address, len(buffer), ctypes.byref(offset),
+                    self.heads, self.batch_size)
+            fields = memoryview(self.heads).cast('B').cast('q')
+            fields = fields[:count * self.num_fields].tolist()
+            field_iter = iter(fields)
+            yield zip(*([field_iter] * self.num_fields))
+            if count < self.batch_size:
+                break
+
+
+_native_scanner :'Optional[NativeScanner]' = None
+
+
+def load_native_scanner()->'Optional[NativeScanner]':
+    """
+    load the native scanner from $YSL_GLOG_SCANNER or GLOG_SCANNER_LIBRARY beside this module,
+    None is returned if it's not available
+    """
+
+    global _native_scanner
+
+    if _native_scanner is None:
+        path = os.environ.get('YSL_GLOG_SCANNER', '')
+        if not path:
+            path = os.path.join(os.path.dirname(os.path.abspath(__file__)), GLOG_SCANNER_LIBRARY)
+        try:
+            _native_scanner = NativeScanner(path)
+        except OSError:
+            _native_scanner = False
+    return _native_scanner or None
+
+
 class GlogParser(object):
     """
     GlogParser:
         if `text_stream` given, parser is iterable within this stream
         if `hold_last` is True, the last record will not be emitted by default
+        if `native` is None, the native scanner is used when available
+        if `record_filter`(filters.RecordFilter) given, non-matching records are skipped
+        at the head scanning
+    the input is processed as a rolling bytes buffer: only the incomplete last line is
+    carried between blocks and the message of the last record is kept as a list of pieces,
+    so the cost is linear in the input size
     """
 
     LEVEL_MAPPING :'Mapping[Any, int]' = {
             0: 0, 1: 1, 2: 2, 3: 3,
             'I': 0, 'W': 1, 'E': 2, 'F': 3,
             'INFO': 0, 'WARNING': 1, 'ERROR': 2, 'FATAL': 3,
+            b'I': 0, b'W': 1, b'E': 2, b'F': 3,
             }
 
-    @classmethod
-    def make_record(
-            cls,
-            *args,
-            append_msg:str='')->record:
-        """
-        make a 'record' with the matched pattern
-        `append_msg` is appended to .msg
-        """
-
-        level, date, thread_id, filename, line, msg = args
-        level = cls.LEVEL_MAPPING[level]
-        thread_id = int(thread_id)
-        line = int(line)
-        if not isinstance(date, datetime):
-            date = datetime.strptime(date, '%m%d %H:%M:%S.%f')
-        msg += append_msg
-        return record(level, date, thread_id, filename, line, msg)
-
     def __init__(self,
                  text_stream:'Optional[Iterable[str]]'=None,
-                 hold_last:bool=True):
+                 hold_last:bool=True,
+                 native:'Optional[bool]'=None,
+                 record_filter:'Optional[RecordFilter]'=None):
         self.stream = text_stream
         self.hold_last = hold_last
+        self.record_filter = record_filter
+        self.scanner = load_native_scanner() if native is not False else None
+        assert self.scanner or not native, 'native scanner is not available'
+
         self.reset()
 
     def __iter__(self):
@@ -76,10 +228,11 @@ class GlogParser(object):
     def reset(self):
         """reset state"""
 
-        self.last_buffer = ''
-        self.last_record = None
+        self.last_line = [] # pieces of the incomplete last line
+        self.last_head = None # head fields of the last record, False if filtered
+        self.last_msg = [] # message pieces of the last record
 
-    def process(self, text_stream:'Iterable[str]')->'Iterable[record]':
+    def process(self, text_stream:'Iterable[Union[str, bytes]]')->'Iterable[record]':
         """parse glog `text_stream` into record stream"""
 
         self.reset()
@@ -93,34 +246,128 @@ class GlogParser(object):
         if `hold_last` is True, the last record will not be emitted
         """
 
-        if isinstance(buffer, bytes):
-            buffer = buffer.decode('utf-8')
-
-        buffer = self.last_buffer + buffer
-        match_iter = GLOG_PERROR_REGEX.finditer(buffer)
-        last_end = 0
-        buffer_ = ''
-        for match in match_iter:
-            buffer_ += buffer[last_end:match.start()]
-            last_end = match.end()
-        buffer_ += buffer[last_end:]
-        buffer = buffer_
-
-        match_iter = GLOG_HEAD_REGEX.finditer(buffer)
-        last_end = 0
-        for match in match_iter:
-            if self.last_record is not None:
-                yield self.make_record(*self.last_record,
-                                       append_msg=buffer[last_end:match.start()])
-            self.last_record = self.make_record(*match.groups(), '')
-            last_end = match.end()
+        if isinstance(buffer, str):
+            buffer = buffer.encode('utf-8')
 
         if hold_last:
-            self.last_buffer = buffer[last_end:]
-        elif self.last_record is not None:
-            yield self.make_record(*self.last_record, append_msg=buffer[last_end:])
+            split = buffer.rfind(b'\n') + 1
+            if split == 0: # no complete line yet
+                self.last_line.append(buffer)
+                return
+
+            if self.last_line:
+                self.last_line.append(buffer[:split])
+                buffer, self.last_line = b''.join(self.last_line), [buffer[split:]]
+            elif split < len(buffer):
+                buffer, self.last_line = buffer[:split], [buffer[split:]]
+        elif self.last_line:
+            self.last_line.append(buffer)
+            buffer, self.last_line = b''.join(self.last_line), []
+
+        buffer = self.strip(buffer)
+        last_end = 0
+        for begin, end, *head in self.scan(buffer):
+            if self.last_head:
+                self.last_msg.append(buffer[last_end:begin])
+                yield self.pop_record()
+            self.last_head = head or False
+            last_end = end
+        if self.last_head:
+            self.last_msg.append(buffer[last_end:])
+
+        if not hold_last:
+            if self.last_head:
+                yield self.pop_record()
             self.reset()
 
+    def pop_record(self)->record:
+        """make the last record with its message pieces"""
+
+        msg = b''.join(self.last_msg).decode('utf-8')
+        self.last_msg = []
+        return record(*self.last_head, msg)
+
+    def strip(self, buffer:bytes)->'Union[bytes, bytearray]':
+        """remove GLOG_PERROR_PATTEN from `buffer`"""
+
+        if self.scanner:
+            return self.scanner.strip(buffer)
+
+        return GLOG_PERROR_BYTES_REGEX.sub(b'', buffer)
+
+    def scan(self, buffer:'Union[bytes, bytearray]')->'Iterable[Tuple[Any, ...]]':
+        """
+        scan record heads in `buffer`, yield
+        (begin, end, level, raw date, thread_id, filename, line),
+        or only (begin, end) for records rejected by the record_filter
+        """
+
+        record_filter = self.record_filter
+        if self.scanner:
+            for heads in self.scanner.scan(buffer):
+                for (begin, end, level, month, day, hour, minute, second, microsecond,
+                     thread_id, filename_begin, filename_end, line) in heads:
+                    if record_filter and not record_filter.accept_head(level, thread_id):
+                        yield begin, end
+                        continue
+
+                    filename = buffer[filename_begin:filename_end].decode('utf-8')
+                    if record_filter and not record_filter.accept_filename(filename):
+                        yield begin, end
+                        continue
+
+                    date = month, day, hour, minute, second, microsecond
+                    yield begin, end, level, date, thread_id, filename, line
+        else:
+            level_mapping = self.LEVEL_MAPPING
+            for match in GLOG_HEAD_BYTES_REGEX.finditer(buffer):
+                level, date, thread_id, filename, line = match.groups()
+                level, thread_id = level_mapping[level], int(thread_id)
+                if record_filter and not record_filter.accept_head(level, thread_id):
+                    yield match.start(), match.end()
+                    continue
+
+                filename = filename.decode('utf-8')
+                if record_filter and not record_filter.accept_filename(filename):
+                    yield match.start(), match.end()
+                    continue
+
+                yield (match.start(), match.end(), level, date, thread_id, filename,
+                       int(line))
+
+
+def benchmark(size:int,
+              native:'Optional[bool]'=None,
+              block_size:int=1 << 16)->float:
+    """
+    throughput regression test on a synthetic log of about `size` MB,
+    long multi-line records (like tensor literals) are included
+    throughput(MB/s) is returned
+    """
+
+    import time
+
+    head = 'I0926 15:42:30.953778 12990 main.cpp:{}] '
+    short = ''.join(head.format(20 + idx) + f'key_{idx}: {idx * 0.5}\n' for idx in range(8))
+    tensor = head.format(30) + 'tensor: !tensor |\n' + ''.join(
+            '    [' + ', '.join(['0.123456'] * 16) + '],\n' for _ in range(4096))
+    block = (short * 64 + tensor).encode('utf-8')
+    num_blocks = max(1, size * (1 << 20) // len(block))
+
+    def text_stream():
+        for _ in range(num_blocks):
+            for offset in range(0, len(block), block_size):
+                yield block[offset:offset + block_size]
+
+    parser = GlogParser(native=native)
+    num_records = 0
+    begin = time.time()
+    for rec in parser.process(text_stream()):
+        num_records += 1
+    elapsed = time.time() - begin
+    assert num_records == num_blocks * (8 * 64 + 1) - 1
+    return len(block) * num_blocks / (1 << 20) / elapsed
+
 
 if __name__ == '__main__':
     import argparse, re
@@ -130,39 +377,61 @@ if __name__ == '__main__':
             formatter_class=argparse.ArgumentDefaultsHelpFormatter,
             )
     parser.add_argument(
-            'log_path', nargs=1,
+            'log_path', nargs='?',
             help='path to log file',
             )
     parser.add_argument(
             '--filter', '-f', action='append',
             help='filter: filter_name=args',
             )
+    parser.add_argument(
+            '--benchmark', type=int, metavar='MB',
+            help='run throughput regression test on synthetic log of MB megabytes',
+            )
     args = parser.parse_args()
 
+    if args.benchmark:
+        natives = [False, True] if load_native_scanner() else [False]
+        for native in natives:
+            # throughput should not drop with the log size if parsing is linear-time
+            throughputs = [benchmark(size, native=native)
+                           for size in (max(1, args.benchmark // 8), args.benchmark)]
+            print('native:', native, 'throughput(MB/s):', *map('{:.1f}'.format, throughputs))
+            assert throughputs[1] > throughputs[0] * .5, 'throughput regression'
+        parser.exit()
+
+    if not args.log_path:
+        parser.error('log_path is required')
+
     import filters
 
-    from backends import tailc, ssh_tailc
+    from backends import followc, ssh_tailc
 
-    log_path = args.log_path[0]
+    log_path = args.log_path
 
-    # auto local / remote tailc
+    # auto local follower / remote tailc
     match = re.fullmatch(r'((\w+@)?.+):(.+)', log_path)
     if match is None:
         print('reading local file:', log_path)
-        proc = tailc(log_path)
+        text_stream = followc(log_path)
     else:
         address, _, log_path = match.groups()
         print('reading SSH remote file:', log_path)
-        proc = ssh_tailc(address, log_path)
-
-    parser = GlogParser()
-    record_stream = parser.process(proc.stdout)
-    if args.filter:
-        for param in args.filter:
-            filter_name, _, filter_param = param.partition('=')
-            func = getattr(filters, filter_name + '_filter')
-            filter_params = [filter_param] if filter_param else []
-            record_stream = func(record_stream, *filter_params)
+        text_stream = ssh_tailc(address, log_path).stdout
+
+    # level, thread and filename filters are pushed down into the parser
+    record_filter = filters.RecordFilter()
+    post_filters = []
+    for param in args.filter or []:
+        filter_name, _, filter_param = param.partition('=')
+        filter_params = [filter_param] if filter_param else []
+        if not record_filter.add(filter_name, *filter_params):
+            post_filters.append((getattr(filters, filter_name + '_filter'), filter_params))
+
+    parser = GlogParser(record_filter=record_filter)
+    record_stream = parser.process(text_stream)
+    for func, filter_params in post_filters:
+        record_stream = func(record_stream, *filter_params)
     msg_stream = get_msg(record_stream)
     for msg in msg_stream:
         print(msg, end='')
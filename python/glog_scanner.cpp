@@ -0,0 +1,287 @@
+/*
+
+Native glog record scanner for glog_parser.py, loaded with ctypes
+Copyright (c) 2026 agent
+
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//// matches GLOG_HEAD_PATTEN and GLOG_PERROR_PATTEN in glog_parser.py,
+//// bytes flavor: \s, \d, \w are ASCII only
+
+namespace
+{
+
+// matched glog record head, all fields are int64 so that the layout is a flat array
+struct GlogHead
+{
+	std::int64_t begin, end; // head span in buffer, message starts at end
+	std::int64_t level;      // 0: I, 1: W, 2: E, 3: F
+	std::int64_t month, day, hour, minute, second, microsecond;
+	std::int64_t thread_id;
+	std::int64_t filename_begin, filename_end;
+	std::int64_t line;
+};
+
+inline bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline bool is_word(char c)
+{
+	return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline int level_of(char c)
+{
+	switch (c)
+	{
+	case 'I':
+	{
+		return 0;
+	}
+	case 'W':
+	{
+		return 1;
+	}
+	case 'E':
+	{
+		return 2;
+	}
+	case 'F':
+	{
+		return 3;
+	}
+	default:
+	{
+		return -1;
+	}
+	}
+}
+
+class Cursor
+{
+public:
+	Cursor(const char* begin, const char* end) noexcept
+		: m_pos(begin)
+		, m_end(end)
+	{}
+
+	inline const char* pos() const noexcept
+	{
+		return m_pos;
+	}
+
+	inline bool get(char c) noexcept
+	{
+		if (m_pos < m_end && *m_pos == c)
+		{
+			++m_pos;
+			return true;
+		}
+
+		return false;
+	}
+
+	// exactly n digits
+	inline bool digits(int n, std::int64_t& value) noexcept
+	{
+		if (m_end - m_pos < n)
+		{
+			return false;
+		}
+
+		value = 0;
+		for (int i = 0; i < n; ++i, ++m_pos)
+		{
+			if (!is_digit(*m_pos))
+			{
+				return false;
+			}
+
+			value = value * 10 + (*m_pos - '0');
+		}
+		return true;
+	}
+
+	// \d+
+	inline bool number(std::int64_t& value) noexcept
+	{
+		const auto begin = m_pos;
+		value            = 0;
+		while (m_pos < m_end && is_digit(*m_pos))
+		{
+			value = value * 10 + (*m_pos++ - '0');
+		}
+		return m_pos != begin;
+	}
+
+	// \s+
+	inline bool spaces() noexcept
+	{
+		const auto begin = m_pos;
+		while (m_pos < m_end && is_space(*m_pos))
+		{
+			++m_pos;
+		}
+		return m_pos != begin;
+	}
+
+	// \w+
+	inline bool word() noexcept
+	{
+		const auto begin = m_pos;
+		while (m_pos < m_end && is_word(*m_pos))
+		{
+			++m_pos;
+		}
+		return m_pos != begin;
+	}
+
+	// \s
+	inline bool space() noexcept
+	{
+		if (m_pos < m_end && is_space(*m_pos))
+		{
+			++m_pos;
+			return true;
+		}
+
+		return false;
+	}
+
+private:
+	const char*       m_pos;
+	const char* const m_end;
+};
+
+// ([IWEF])(\d{4}\s+\d\d:\d\d:\d\d\.\d{6})\s+(\d+)\s+(\w+\.\w+):(\d+)\]\s
+inline bool match_head(const char* buffer, const char* begin, const char* end, GlogHead& head)
+{
+	Cursor       cursor(begin + 1, end);
+	std::int64_t date{};
+
+	head.level = level_of(*begin);
+	if (head.level < 0 || !cursor.digits(4, date) || !cursor.spaces() ||
+		!cursor.digits(2, head.hour) || !cursor.get(':') || !cursor.digits(2, head.minute) ||
+		!cursor.get(':') || !cursor.digits(2, head.second) || !cursor.get('.') ||
+		!cursor.digits(6, head.microsecond) || !cursor.spaces() ||
+		!cursor.number(head.thread_id) || !cursor.spaces())
+	{
+		return false;
+	}
+
+	head.filename_begin = cursor.pos() - buffer;
+	if (!cursor.word() || !cursor.get('.') || !cursor.word())
+	{
+		return false;
+	}
+
+	head.filename_end = cursor.pos() - buffer;
+	if (!cursor.get(':') || !cursor.number(head.line) || !cursor.get(']') || !cursor.space())
+	{
+		return false;
+	}
+
+	head.begin = begin - buffer;
+	head.end   = cursor.pos() - buffer;
+	head.month = date / 100;
+	head.day   = date % 100;
+	return true;
+}
+
+// C(ould not create log|OULD NOT CREATE LOG).+\n, return match end or nullptr
+inline const char* match_perror(const char* begin, const char* end)
+{
+	static const char        lower[] = "Could not create log";
+	static const char        upper[] = "COULD NOT CREATE LOG";
+	constexpr std::ptrdiff_t length  = sizeof(lower) - 1;
+
+	if (end - begin < length + 2 ||
+		(std::memcmp(begin, lower, length) != 0 && std::memcmp(begin, upper, length) != 0))
+	{
+		return nullptr;
+	}
+
+	const auto rest = begin + length;
+	const auto eol  = static_cast<const char*>(std::memchr(rest, '\n', end - rest));
+	return eol == nullptr || eol == rest ? nullptr : eol + 1;
+}
+
+} // namespace
+
+extern "C" {
+
+// number of int64 fields per head
+std::size_t ysl_glog_head_fields()
+{
+	return sizeof(GlogHead) / sizeof(std::int64_t);
+}
+
+// copy `src` into `dst` with GLOG_PERROR_PATTEN removed, return the new size
+std::size_t ysl_glog_strip_perror(const char* src, std::size_t size, char* dst)
+{
+	const auto end = src + size;
+	auto       out = dst;
+	auto       pos = src;
+	while (pos < end)
+	{
+		const auto c = static_cast<const char*>(std::memchr(pos, 'C', end - pos));
+		if (c == nullptr)
+		{
+			break;
+		}
+
+		const auto match_end = match_perror(c, end);
+		if (match_end == nullptr)
+		{
+			std::memmove(out, pos, c + 1 - pos);
+			out += c + 1 - pos;
+			pos = c + 1;
+			continue;
+		}
+
+		std::memmove(out, pos, c - pos);
+		out += c - pos;
+		pos = match_end;
+	}
+	std::memmove(out, pos, end - pos);
+	out += end - pos;
+	return out - dst;
+}
+
+// scan record heads in `buffer` from `*offset`, up to `capacity` heads are stored,
+// `*offset` is updated to resume the scan, scanning is done if return < capacity
+std::size_t ysl_glog_scan_heads(const char* buffer, std::size_t size, std::size_t* offset,
+								GlogHead* heads, std::size_t capacity)
+{
+	const auto  end   = buffer + size;
+	auto        pos   = buffer + *offset;
+	std::size_t count = 0;
+	while (count < capacity && pos + 1 < end)
+	{
+		if (level_of(*pos) >= 0 && is_digit(pos[1]) && match_head(buffer, pos, end, heads[count]))
+		{
+			pos = buffer + heads[count].end;
+			++count;
+		}
+		else
+		{
+			++pos;
+		}
+	}
+
+	*offset = count < capacity ? size : static_cast<std::size_t>(pos - buffer);
+	return count;
+}
+
+} // extern "C"
@@ -163,15 +163,122 @@ class FrameParser(StreamParser):
 #        return frame, document
 
 
+class DocumentSplitter(StreamParser):
+    """
+    DocumentSplitter splits YAML text lines into documents at document markers('---', '...'),
+    the text of a completed document is returned by parse, or None,
+    the last document is returned by flush,
+    .span is the (begin, end) of the last returned document in the text
+    """
+
+    PATTERN :str = r'(?:---|\.\.\.)(?:\s|$)'
+    REGEX = re.compile(PATTERN)
+
+    def reset(self):
+        self.lines = []
+        self.begin = 0
+        self.span = None
+
+    def parse(self, line:str)->'Optional[str]':
+        if line[:3] == '---' and self.REGEX.match(line):
+            ret = self.flush()
+            self.lines.append(line)
+            return ret
+
+        self.lines.append(line)
+        if line[:3] == '...' and self.REGEX.match(line):
+            return self.flush()
+
+        return None
+
+    def flush(self)->'Optional[str]':
+        """pop the current document"""
+
+        if not self.lines:
+            return None
+
+        ret = ''.join(self.lines)
+        self.lines = []
+        self.span = self.begin, self.begin + len(ret)
+        self.begin += len(ret)
+        return ret
+
+
+CONTEXT_PATTERN :str = r'# YSL::Context (\d+)( \+)?(?:\n|$)'
+CONTEXT_REGEX = re.compile(CONTEXT_PATTERN)
+
+
+def match_context(msg:str)->'Optional[Tuple[int, bool, str]]':
+    """
+    match the glog message of a record published by YSL::Context, return
+    (key, continued, text) or None, key is the negated context id, used in place of thread_id,
+    the text of a continued record is followed by the next record of the same context
+    """
+
+    if msg[:15] != '# YSL::Context ':
+        return None
+
+    match = CONTEXT_REGEX.match(msg)
+    if match is None:
+        return None
+
+    context_id, continued = match.groups()
+    return -int(context_id), bool(continued), msg[match.end():]
+
+
+class LazyDocument(object):
+    """
+    YSL frame document with raw text, parsed on the first access of .document
+    thread_id is the negated context id for a document of YSL::Context(see match_context)
+    span is the (begin, end) of text in the message stream of the thread, or in the text of
+    the records of the context
+    """
+
+    __slots__ = ('name', 'index', 'thread_id', 'span', 'text', 'yaml_loader_cls', 'cache')
+
+    def __init__(self, name:str, index:'Optional[int]', thread_id:int,
+                 span:'Tuple[int, int]', text:str, yaml_loader_cls:type):
+        self.name = name
+        self.index = index
+        self.thread_id = thread_id
+        self.span = span
+        self.text = text
+        self.yaml_loader_cls = yaml_loader_cls
+        self.cache = self # not loaded
+
+    def __repr__(self):
+        return (f'LazyDocument(name={self.name!r}, index={self.index!r}, '
+                f'thread_id={self.thread_id!r}, span={self.span!r})')
+
+    @property
+    def frame(self)->frame:
+        return frame(self.name, self.index)
+
+    @property
+    def document(self)->'Any':
+        """the parsed document, raise 'yaml.YAMLError' on parser error"""
+
+        if self.cache is self:
+            documents = list(yaml.load_all(self.text, Loader=self.yaml_loader_cls))
+            self.cache = documents[0] if documents else None
+        return self.cache
+
+
 def frame_parser(
         text_stream:'Iterable[str]',
-        yaml_loader_cls:type=yaml.SafeLoader,
+        yaml_loader_cls:'Optional[type]'=None,
         persistent:bool=False) -> 'Iterable[Tuple[str, Any]]':
     """
     YSL Yaml frame parser, yield each (frame, document)
+    if `yaml_loader_cls` is None, constructors.DefaultLogLoader is used(libyaml if available)
     raise 'yaml.YAMLError' if any yaml parser error encountered and persistent is False
     """
 
+    if yaml_loader_cls is None:
+        from constructors import DefaultLogLoader
+
+        yaml_loader_cls = DefaultLogLoader
+
     frame_parser_ = FrameParser()
     text_stream = frame_parser_.process(text_stream)
     io_stream = TextStreamIO(text_stream, force_readline=True)
@@ -180,6 +287,7 @@ def frame_parser(
             frame_parser_.reset()
             for document in yaml.load_all(io_stream, Loader=yaml_loader_cls):
                 yield frame_parser_.pop_frame(), document
+            break # end of stream
         except yaml.YAMLError as e:
             if persistent:
                 logger.warn('got exception:\n%s\nparser will be reseted', e)
@@ -188,13 +296,478 @@ def frame_parser(
                 raise e
 
 
+def lazy_frame_parser(
+        record_stream:'Iterable[record]',
+        yaml_loader_cls:'Optional[type]'=None) -> 'Iterable[LazyDocument]':
+    """
+    single-pass YSL frame splitter on glog records of multiple threads,
+    yield a LazyDocument once the document of the thread completes,
+    i.e. at the next document marker of the same thread, or the end of stream,
+    records of YSL::Context are reassembled by the context instead(see match_context),
+    whose documents complete at the end of a record not continued,
+    only frame headers are parsed until .document is accessed
+    """
+
+    if yaml_loader_cls is None:
+        from constructors import DefaultLogLoader
+
+        yaml_loader_cls = DefaultLogLoader
+
+    blank_regex = re.compile(r'(?:[ \t]*(?:#.*)?\n|\.\.\.(?:\s.*)?\n?)*')
+
+    def make(thread_id:int, splitter:DocumentSplitter, text:str)->'Optional[LazyDocument]':
+        head, newline, _ = text.partition('\n')
+        match = FrameParser.REGEX.fullmatch(head + newline)
+        if match is not None:
+            name, index = FrameParser.make_frame(*match.groups())
+        elif head[:3] != '---' and blank_regex.fullmatch(text):
+            return None # comments only
+        else:
+            name, index = '', -1
+        return LazyDocument(name, index, thread_id, splitter.span, text, yaml_loader_cls)
+
+    splitters = dict()
+    contexts = dict() # key: splitter of a continued context record
+    for record in record_stream:
+        context = match_context(record.msg)
+        if context is not None:
+            key, continued, body = context
+            splitter = contexts.pop(key, None) or DocumentSplitter()
+            for line in io.StringIO(body):
+                text = splitter.parse(line)
+                if text is not None:
+                    lazy_document = make(key, splitter, text)
+                    if lazy_document is not None:
+                        yield lazy_document
+            if continued:
+                contexts[key] = splitter
+                continue
+
+            text = splitter.flush()
+            if text is not None:
+                lazy_document = make(key, splitter, text)
+                if lazy_document is not None:
+                    yield lazy_document
+            continue
+
+        splitter = splitters.get(record.thread_id)
+        if splitter is None:
+            splitter = splitters[record.thread_id] = DocumentSplitter()
+        text = splitter.parse(record.msg)
+        if text is not None:
+            lazy_document = make(record.thread_id, splitter, text)
+            if lazy_document is not None:
+                yield lazy_document
+
+    splitters.update(contexts)
+    for thread_id, splitter in splitters.items():
+        text = splitter.flush()
+        if text is not None:
+            lazy_document = make(thread_id, splitter, text)
+            if lazy_document is not None:
+                yield lazy_document
+
+
+def demux_frame_parser(
+        record_stream:'Iterable[record]',
+        yaml_loader_cls:'Optional[type]'=None,
+        persistent:bool=False) -> 'Iterable[Tuple[int, frame, Any]]':
+    """
+    single-pass YSL frame parser on glog records of multiple threads,
+    yield each (thread_id, frame, document) once the document of the thread completes,
+    thread_id is the negated context id for a document of YSL::Context, see lazy_frame_parser
+    a broken document is dropped with a warning if `persistent`, not affecting other threads,
+    otherwise 'yaml.YAMLError' is raised
+    """
+
+    for lazy_document in lazy_frame_parser(record_stream, yaml_loader_cls=yaml_loader_cls):
+        try:
+            document = lazy_document.document
+        except yaml.YAMLError as e:
+            if not persistent:
+                raise e
+
+            logger.warn('got exception in thread %d:\n%s\ndocument is dropped',
+                        lazy_document.thread_id, e)
+            continue
+
+        yield lazy_document.thread_id, lazy_document.frame, document
+
+
+def shm_frame_parser(
+        document_stream:'Iterable[shm_document]',
+        yaml_loader_cls:'Optional[type]'=None,
+        persistent:bool=False) -> 'Iterable[Tuple[frame, Any]]':
+    """
+    YSL frame parser on complete documents from backends.SharedMemoryRing, yield each
+    (frame, document), documents of comments only are skipped
+    a broken document is dropped with a warning if `persistent`,
+    otherwise 'yaml.YAMLError' is raised
+    """
+
+    if yaml_loader_cls is None:
+        from constructors import DefaultLogLoader
+
+        yaml_loader_cls = DefaultLogLoader
+
+    for shm_document in document_stream:
+        try:
+            documents = list(yaml.load_all(shm_document.text, Loader=yaml_loader_cls))
+        except yaml.YAMLError as e:
+            if not persistent:
+                raise e
+
+            logger.warn('got exception in thread %d:\n%s\ndocument is dropped',
+                        shm_document.thread_id, e)
+            continue
+
+        if documents:
+            yield frame(shm_document.name, shm_document.index), documents[0]
+
+
+def lazy_shm_frame_parser(
+        document_stream:'Iterable[shm_document]',
+        yaml_loader_cls:'Optional[type]'=None) -> 'Iterable[LazyDocument]':
+    """
+    lazy YSL frame parser on complete documents from backends.SharedMemoryRing,
+    yield a LazyDocument of each document, see shm_frame_parser
+    """
+
+    if yaml_loader_cls is None:
+        from constructors import DefaultLogLoader
+
+        yaml_loader_cls = DefaultLogLoader
+
+    for shm_document in document_stream:
+        yield LazyDocument(shm_document.name, shm_document.index, shm_document.thread_id,
+                           None, shm_document.text, yaml_loader_cls)
+
+
+def timed_frame_parser(
+        record_stream:'Iterable[record]',
+        yaml_loader_cls:'Optional[type]'=None,
+        persistent:bool=False) -> 'Iterable[Tuple[frame, Any, Any]]':
+    """
+    frame_parser on glog records, yield each (frame, document, date),
+    date is the raw date of the frame header record(see glog_parser.decode_date),
+    None if the document has no frame header,
+    records of YSL::Context are skipped as they are not of the thread(see lazy_frame_parser)
+    """
+
+    from collections import deque
+
+    headers = deque() # (frame, raw date)
+
+    def msg_stream()->'Iterable[str]':
+        for record in record_stream:
+            if match_context(record.msg) is not None:
+                continue
+
+            match = FrameParser.REGEX.fullmatch(record.msg)
+            if match is not None:
+                headers.append((FrameParser.make_frame(*match.groups()), record.raw_date))
+            yield record.msg
+
+    no_frame = frame('', -1)
+    for frame_, document in frame_parser(msg_stream(), yaml_loader_cls=yaml_loader_cls,
+                                         persistent=persistent):
+        date = None
+        if frame_ != no_frame:
+            # headers dropped by a parser reset are skipped
+            while headers and headers[0][0] != frame_:
+                headers.popleft()
+            if headers:
+                date = headers.popleft()[1]
+        yield frame_, document, date
+
+
+def resolve_schema(
+        frame_stream:'Iterable[Tuple[Any, ...]]')->'Iterable[Tuple[Any, ...]]':
+    """
+    resolve rows of schema-declared frames(see YSL::FrameSchema)
+    in `frame_stream` of (frame, document) or (thread_id, frame, document),
+    '!schema' documents are consumed, '!row' documents are rebuilt as dict of schema keys,
+    schemas are tracked per thread and frame name,
+    rows without a known schema are yielded as is
+    """
+
+    from constructors import FrameSchema, SchemaRow
+
+    schemas = dict() # (*prefix, name): keys
+    for item in frame_stream:
+        *prefix, frame_, document = item
+        if isinstance(document, FrameSchema):
+            schemas[(*prefix, frame_.name)] = document.keys
+            continue
+
+        if isinstance(document, SchemaRow):
+            keys = schemas.get((*prefix, frame_.name))
+            if keys is not None:
+                if len(keys) != len(document):
+                    logger.warn('row of %d values mismatches schema of %s keys in frame %s',
+                                len(document), len(keys), frame_)
+                item = (*prefix, frame_, dict(zip(keys, document)))
+        yield item
+
+
+class DeltaResolver(StreamParser):
+    """
+    DeltaResolver rebuilds full documents of delta frames(see YSL::DeltaFrames)
+    on items of (frame, document) or (thread_id, frame, document), see resolve_delta,
+    the resolved item is returned by parse, or None if dropped
+    """
+
+    def __init__(self,
+                 stream:'Optional[Iterable[Any]]'=None,
+                 partial:bool=True):
+        self.partial = partial
+        super().__init__(stream)
+
+    @classmethod
+    def merge(cls, base:dict, delta:dict)->dict:
+        """merge `delta` into a copy of `base` recursively"""
+
+        ret = dict(base)
+        for key, value in delta.items():
+            base_value = ret.get(key)
+            if isinstance(value, dict) and isinstance(base_value, dict):
+                value = cls.merge(base_value, value)
+            ret[key] = value
+        return ret
+
+    def reset(self):
+        self.documents = dict() # (*prefix, name): document
+
+    def parse(self, item:'Tuple[Any, ...]')->'Optional[Tuple[Any, ...]]':
+        from constructors import DeltaDocument
+
+        *prefix, frame_, document = item
+        if isinstance(document, DeltaDocument):
+            base = self.documents.get((*prefix, frame_.name))
+            if base is None:
+                if not self.partial:
+                    return None
+
+                base = dict()
+            document = self.documents[(*prefix, frame_.name)] = self.merge(base, document)
+            item = (*prefix, frame_, document)
+        elif isinstance(document, dict):
+            self.documents[(*prefix, frame_.name)] = document
+        return item
+
+
+def resolve_delta(
+        frame_stream:'Iterable[Tuple[Any, ...]]',
+        partial:bool=True)->'Iterable[Tuple[Any, ...]]':
+    """
+    rebuild full documents of delta frames(see YSL::DeltaFrames)
+    in `frame_stream` of (frame, document) or (thread_id, frame, document),
+    '!delta' documents are merged into the last document of the same frame name recursively,
+    other mappings are keyframes replacing it, documents are tracked per thread and frame name,
+    '!delta' documents before any keyframe are merged into empty documents if `partial`,
+    or dropped otherwise,
+    rebuilt documents share the unchanged mappings with the previous ones
+    """
+
+    for item in DeltaResolver(partial=partial).process(frame_stream):
+        if item is not None:
+            yield item
+
+
+def split_log(buffer:'Union[bytes, mmap.mmap]', num_chunks:int)->'List[Tuple[int, int]]':
+    """
+    split glog `buffer` into about `num_chunks` (begin, end) chunks,
+    each chunk begins with a glog record whose message is a YSL frame header
+    """
+
+    from glog_parser import GLOG_HEAD_PATTEN
+
+    regex = re.compile(rb'\n(?=' + GLOG_HEAD_PATTEN.encode('utf-8') + rb'--- #)')
+    size = len(buffer)
+    ret = []
+    begin = 0
+    for idx in range(1, num_chunks):
+        if begin >= size * idx // num_chunks:
+            continue
+
+        match = regex.search(buffer, size * idx // num_chunks - 1)
+        if match is None:
+            break
+
+        ret.append((begin, match.end()))
+        begin = match.end()
+    ret.append((begin, size))
+    return ret
+
+
+def parse_log_chunk(
+        args:'Tuple[str, int, int, Optional[type], bool]',
+        )->'Mapping[int, Tuple[int, List[str], int, List[Tuple[int, List[Any]]], List[str]]]':
+    """
+    parse a chunk of the glog file, messages are demultiplexed by thread_id and split into
+    segments at frame headers, for each thread_id return
+    (head_seq, head, first_seq, [(completion_seq, [(frame, document), ...]), ...], tail)
+    where head is the messages before the first frame header at first_seq, tail is the last
+    segment, they are left to be stitched with the neighbour chunks,
+    a segment is completed by the next frame header of the same thread at completion_seq,
+    first_seq is None if no frame header is found for the thread in this chunk,
+    records of YSL::Context are keyed by the context(see match_context) and a segment is
+    completed at the end of a record not continued, head includes the completing record
+    """
+
+    import mmap
+
+    from glog_parser import GlogParser
+
+    log_path, begin, end, yaml_loader_cls, persistent = args
+    with open(log_path, 'rb') as f:
+        with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as buffer:
+            records = list(GlogParser(hold_last=False).parse(buffer[begin:end]))
+
+    ret = dict()
+    for seq, record in enumerate(records):
+        msg = record.msg
+        context = match_context(msg)
+        key = record.thread_id if context is None else context[0]
+        state = ret.get(key)
+        if state is None:
+            state = ret[key] = [seq, [], None, [], None]
+        if context is not None:
+            _, continued, body = context
+            lines = list(io.StringIO(body))
+            if state[2] is None:
+                state[1].extend(lines)
+                if not continued:
+                    state[2] = seq
+                    state[4] = []
+            else:
+                state[4].extend(lines)
+                if not continued:
+                    documents = list(frame_parser(state[4], yaml_loader_cls=yaml_loader_cls,
+                                                  persistent=persistent))
+                    state[3].append((seq, documents))
+                    state[4] = []
+        elif FrameParser.REGEX.fullmatch(msg):
+            tail = state[4]
+            if tail is None:
+                state[2] = seq
+            else:
+                documents = list(frame_parser(tail, yaml_loader_cls=yaml_loader_cls,
+                                              persistent=persistent))
+                state[3].append((seq, documents))
+            state[4] = [msg]
+        elif state[4] is None:
+            state[1].append(msg)
+        else:
+            state[4].append(msg)
+    return {thread_id: tuple(state) for thread_id, state in ret.items()}
+
+
+def parallel_frame_parser(
+        log_path:str,
+        processes:'Optional[int]'=None,
+        yaml_loader_cls:'Optional[type]'=None,
+        persistent:bool=False,
+        with_thread_id:bool=False,
+        chunk_size:int=1 << 26)->'Iterable[Tuple[Any, ...]]':
+    """
+    offline parallel frame parser of the glog file, yield each (frame, document),
+    or (thread_id, frame, document) if `with_thread_id`
+    messages are demultiplexed by thread_id, or the context for records of YSL::Context,
+    the file is mmaped and split into chunks of
+    about `chunk_size` at frame headers, parsed in a pool of `processes`,
+    documents are yielded in the order of completion as in a sequential parser,
+    i.e. by the next frame header of the same thread, or the end of file
+    """
+
+    import mmap
+
+    from multiprocessing import Pool
+
+    with open(log_path, 'rb') as f:
+        with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as buffer:
+            num_chunks = max(1, len(buffer) // chunk_size)
+            chunks = split_log(buffer, num_chunks)
+
+    def parse_segment(msgs:'List[str]')->'List[Tuple[Any, Any]]':
+        return list(frame_parser(msgs, yaml_loader_cls=yaml_loader_cls, persistent=persistent))
+
+    pending = dict() # thread_id -> ((chunk, seq), messages of the open segment)
+    tasks = [(log_path, begin, end, yaml_loader_cls, persistent) for begin, end in chunks]
+    with Pool(processes) as pool:
+        for chunk, chunk_result in enumerate(pool.imap(parse_log_chunk, tasks)):
+            results = []
+            for thread_id, (head_seq, head, first_seq, completed, tail) in chunk_result.items():
+                if head:
+                    key, msgs = pending.get(thread_id, ((chunk, head_seq), []))
+                    pending[thread_id] = key, msgs + head
+                if first_seq is None:
+                    continue
+
+                if thread_id in pending:
+                    _, msgs = pending.pop(thread_id)
+                    results.append((first_seq, thread_id, parse_segment(msgs)))
+                results.extend((seq, thread_id, documents) for seq, documents in completed)
+                tail_seq = completed[-1][0] if completed else first_seq
+                pending[thread_id] = (chunk, tail_seq), tail
+
+            for _, thread_id, documents in sorted(results, key=lambda result: result[0]):
+                for frame, document in documents:
+                    yield (thread_id, frame, document) if with_thread_id else (frame, document)
+
+    for thread_id, (_, msgs) in sorted(pending.items(), key=lambda item: item[1][0]):
+        for frame, document in parse_segment(msgs):
+            yield (thread_id, frame, document) if with_thread_id else (frame, document)
+
+
+def benchmark(log_path:str,
+              yaml_loader_clss:'Sequence[type]')->'Mapping[str, float]':
+    """
+    benchmark frame_parser with each loader in `yaml_loader_clss` on the log file,
+    threads are parsed separately, elapsed time(s) is returned
+    """
+
+    import time
+
+    from filters import thread_filter
+    from glog_parser import GlogParser, get_msg
+
+    with open(log_path, 'rb') as f:
+        records = list(GlogParser(hold_last=False).parse(f.read()))
+    thread_ids = sorted(set(rec.thread_id for rec in records))
+
+    ret = dict()
+    for yaml_loader_cls in yaml_loader_clss:
+        begin = time.time()
+        num_documents = 0
+        for thread_id in thread_ids:
+            msg_stream = get_msg(thread_filter(records, thread_id))
+            for _ in frame_parser(msg_stream, yaml_loader_cls=yaml_loader_cls,
+                                  persistent=True):
+                num_documents += 1
+        ret[yaml_loader_cls.__name__] = time.time() - begin
+        logger.info('%s: %d documents in %.3fs',
+                    yaml_loader_cls.__name__, num_documents, ret[yaml_loader_cls.__name__])
+    return ret
+
+
 if __name__ == '__main__':
-    from backends import tailc
+    import sys
+
+    from backends import followc
     from glog_parser import GlogParser, get_msg
 
-    proc = tailc('/tmp/test.log')
+    if len(sys.argv) > 2 and sys.argv[1] == '--benchmark': # e.g. /tmp/demo.log from demo.sh
+        from constructors import CLogLoader, LogLoader
+
+        logging.basicConfig(level=logging.INFO)
+        elapsed = benchmark(sys.argv[2], [LogLoader] + ([CLogLoader] if CLogLoader else []))
+        if CLogLoader:
+            print('speedup: {:.1f}x'.format(elapsed['LogLoader'] / elapsed['CLogLoader']))
+        sys.exit()
+
     glog_parser = GlogParser()
-    record_stream = glog_parser.process(proc.stdout)
+    record_stream = glog_parser.process(followc('/tmp/test.log'))
     msg_stream = get_msg(record_stream)
     frame_stream = frame_parser(msg_stream)
 #    frame_parser_ = FrameParser()
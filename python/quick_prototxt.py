@@ -11,51 +11,167 @@ from __future__ import absolute_import, division, unicode_literals
 import re
 import yaml
 
-from collections import OrderedDict
-from uuid import uuid4
-
 
 DELIMITER :str = '@'
 
+PROTOTXT_TOKEN_REGEX = re.compile(r'''
+    (?:\s|\#[^\n]*)+                                              # spaces and comments
+  | (?P<string>"(?:[^"\\\n]|\\.)*"|'(?:[^'\\\n]|\\.)*')
+  | (?P<number>[-+]?(?:0[xX][0-9a-fA-F]+
+                    |(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?[fF]?)(?![\w.]))
+  | (?P<name>-?[A-Za-z_][\w.]*|\[[\w./]+\])                        # field, enum or extension
+  | (?P<punct>[:{}<>\[\],;])
+''', re.VERBOSE)
+PROTOTXT_ESCAPE_REGEX = re.compile(
+        rb'\\(?:([0-7]{1,3})|x([0-9a-fA-F]{1,2})|u([0-9a-fA-F]{4})|U([0-9a-fA-F]{8})|(.))', re.S)
+PROTOTXT_ESCAPES :'Mapping[bytes, bytes]' = {
+        b'n': b'\n', b't': b'\t', b'r': b'\r', b'a': b'\a', b'b': b'\b', b'f': b'\f',
+        b'v': b'\v', b'\\': b'\\', b"'": b"'", b'"': b'"', b'?': b'?',
+        }
+PROTOTXT_IDENTS :'Mapping[str, Any]' = {
+        'true': True, 'True': True, 'false': False, 'False': False,
+        'inf': float('inf'), '-inf': float('-inf'), 'infinity': float('inf'),
+        '-infinity': float('-inf'), 'nan': float('nan'), '-nan': float('nan'),
+        }
+PROTOTXT_CLOSE :'Mapping[str, str]' = {'{': '}', '<': '>'}
+
+
+def unescape_prototxt(text:str)->'Union[str, bytes]':
+    """decode C escaped string content, bytes is returned if it is not valid UTF-8"""
+
+    if '\\' not in text:
+        return text
+
+    def replace(match:'re.Match')->bytes:
+        octal, hexadecimal, unicode16, unicode32, char = match.groups()
+        if octal:
+            return bytes((int(octal, 8) & 0xff, ))
+        if hexadecimal:
+            return bytes((int(hexadecimal, 16), ))
+        if unicode16 or unicode32:
+            return chr(int(unicode16 or unicode32, 16)).encode('utf-8')
+        return PROTOTXT_ESCAPES.get(char, b'\\' + char)
+
+    data = PROTOTXT_ESCAPE_REGEX.sub(replace, text.encode('utf-8'))
+    try:
+        return data.decode('utf-8')
+    except UnicodeDecodeError:
+        return data
+
+
+def parse_prototxt_number(text:str)->'Union[int, float]':
+    """parse integer or float literal"""
+
+    digits = text.lstrip('+-')
+    sign = -1 if text[0] == '-' else 1
+    if digits[:2] in ('0x', '0X'):
+        return sign * int(digits[2:], 16)
+    if digits[-1] in 'fF':
+        return float(text[:-1])
+    if any(c in digits for c in '.eE'):
+        return float(text)
+    if len(digits) > 1 and digits[0] == '0':
+        return sign * int(digits, 8)
+    return sign * int(digits)
+
 
 def load_prototxt(s:str)->'Dict[str, Any]':
-    """direct deserialize from ProtoBuffer text format"""
+    """
+    direct deserialize from ProtoBuffer text format in a single pass,
+    repeated fields are collected into lists, nested messages are dicts,
+    enums are kept as names, strings are unescaped(bytes if not valid UTF-8)
+    """
+
+    tokens = []
+    pos = 0
+    while pos < len(s):
+        match = PROTOTXT_TOKEN_REGEX.match(s, pos)
+        if match is None:
+            raise ValueError(f'unexpected character {s[pos]!r} at {pos} in prototxt')
+
+        pos = match.end()
+        if match.lastgroup is not None:
+            tokens.append((match.lastgroup, match.group(match.lastgroup)))
+    tokens.append(('end', ''))
+    idx = 0
+
+    def expect(token:str):
+        nonlocal idx
+
+        if tokens[idx] != ('punct', token):
+            raise ValueError(f'expected {token!r}, got {tokens[idx][1]!r} in prototxt')
+
+        idx += 1
+
+    def skip_separator():
+        nonlocal idx
+
+        if tokens[idx] in (('punct', ','), ('punct', ';')):
+            idx += 1
+
+    def parse_value()->'Any':
+        nonlocal idx
+
+        kind, token = tokens[idx]
+        idx += 1
+        if kind == 'punct' and token in PROTOTXT_CLOSE:
+            return parse_message(PROTOTXT_CLOSE[token])
+        if kind == 'string':
+            text = token[1:-1]
+            while tokens[idx][0] == 'string': # adjacent strings are concatenated
+                text += tokens[idx][1][1:-1]
+                idx += 1
+            return unescape_prototxt(text)
+        if kind == 'number':
+            return parse_prototxt_number(token)
+        if kind == 'name':
+            return PROTOTXT_IDENTS.get(token, PROTOTXT_IDENTS.get(token.lower(), token))
+        raise ValueError(f'expected value, got {token!r} in prototxt')
+
+    def parse_message(closing:str)->'Dict[str, Any]':
+        nonlocal idx
+
+        message = dict()
+        repeated = set() # fields collected as list
+        while True:
+            kind, token = tokens[idx]
+            idx += 1
+            if kind == 'end' or (kind == 'punct' and token == closing):
+                if token != closing:
+                    raise ValueError(f'expected {closing!r} before end of prototxt')
+
+                return message
+
+            if kind != 'name':
+                raise ValueError(f'expected field name, got {token!r} in prototxt')
+
+            field = token
+            has_colon = tokens[idx] == ('punct', ':')
+            idx += has_colon
+            if tokens[idx] == ('punct', '['): # short list
+                idx += 1
+                values = []
+                while tokens[idx] != ('punct', ']'):
+                    if values:
+                        expect(',')
+                    values.append(parse_value())
+                idx += 1
+            elif has_colon or tokens[idx][1] in PROTOTXT_CLOSE:
+                values = [parse_value()]
+                if field not in repeated and field not in message:
+                    message[field] = values[0]
+                    skip_separator()
+                    continue
+            else:
+                raise ValueError(f'expected : after {field!r} in prototxt')
 
-    unames = OrderedDict()
+            if field in message and field not in repeated:
+                message[field] = [message[field]]
+            message.setdefault(field, []).extend(values)
+            repeated.add(field)
+            skip_separator()
 
-    def replace_key(s):
-        t = ''
-        start = 0
-        for m in re.finditer(r'(\w+)\s*:', s): # HINT: ^\s*\w+\s*:
-            ok, = m.groups()
-            nk = ok + DELIMITER + uuid4().hex
-            unames[nk] = ok
-            t += s[start:m.start()]
-            t += nk + ':'
-            start = m.end()
-        return t + s[start:]
-
-    def restore_key(no):
-        oo = type(no)()
-        for nk, nv in no.items():
-            ok = unames[nk]
-            nv = restore_key(nv) if isinstance(nv, dict) else nv
-            ov = oo.get(ok, None)
-            if ov is None:
-                oo[ok] = nv
-            else:
-                if not isinstance(ov, list):
-                    oo[ok] = [ov]
-                oo[ok].append(nv)
-        return oo
-
-    s = re.sub(r'\{\s+\n', '{\n', s) # remove space between { and \n
-    s = re.sub(r'\s*\{', ': {', s) # add : for field, HINT: \w+\s*{
-    s = replace_key(s)
-    s = re.sub(r'(?<=[^\{])\n', ',\n', s) # add, for flow mapping
-    # s = '{\n  ' + s.strip().replace('\n', '\n  ') + '\n}' # add root flow mapping brace
-    s = '{' + s + '}' # simply
-    return restore_key(yaml.safe_load(s))
+    return parse_message('')
 
 
 def dump_prototxt(o:'Mapping[str, Any]')->str:
@@ -8,9 +8,10 @@ Created on Fri Sep 20 10:42:02 2019
 
 from __future__ import absolute_import, division, unicode_literals
 
-import logging, re
+import logging, pickle, re, struct
 
-from multiprocessing import Process, Pipe
+from collections.abc import Mapping
+from multiprocessing import Process, Pipe, Semaphore
 
 try:
     import tqdm_color_logging
@@ -26,17 +27,421 @@ def kill_proc(proc:Process):
     os.kill(proc.pid, signal.SIGKILL)
 
 
+def recv_batch(data_pipe:'Any', max_count:int)->'List[Any]':
+    """receive at least one and up to `max_count` items from a Pipe or SharedFrameTransport"""
+
+    if hasattr(data_pipe, 'recv_batch'):
+        return data_pipe.recv_batch(max_count)
+
+    ret = [data_pipe.recv()]
+    while len(ret) < max_count and data_pipe.poll():
+        ret.append(data_pipe.recv())
+    return ret
+
+
+class NumericDocument(Mapping):
+    """
+    read-only mapping view of a flat numeric document in SharedFrameTransport,
+    .values is the typed memoryview in the shared memory (e.g. for numpy.frombuffer)
+    """
+
+    def __init__(self, keys:'Sequence[str]', index:'Mapping[str, int]', values:memoryview):
+        self.keys_ = keys
+        self.index = index
+        self.values = values
+
+    def __getitem__(self, key:str)->'Union[int, float]':
+        return self.values[self.index[key]]
+
+    def __iter__(self)->'Iterator[str]':
+        return iter(self.keys_)
+
+    def __len__(self)->int:
+        return len(self.keys_)
+
+    def __repr__(self):
+        return f'NumericDocument({dict(self)})'
+
+
+class SharedFrameTransport(object):
+    """
+    single-producer single-consumer shared memory ring of (frame, document),
+    with Connection-like send / recv / poll
+    flat mappings of int or float are laid out as typed arrays and received as NumericDocument
+    without copy, received documents are valid until the next recv / recv_batch,
+    the frame type, name and keys are only sent when changed
+    other documents are pickled into the slot, or sent through a pipe if they do not fit
+    """
+
+    # kind, typecode, frame index is None, meta size, frame index, num values
+    HEADER :struct.Struct = struct.Struct('<Bc?xIqQ')
+    KIND_NUMERIC   :int = 0
+    KIND_PICKLED   :int = 1
+    KIND_OVERFLOW  :int = 2
+
+    def __init__(self,
+                 num_slots:int=1024, slot_size:int=1 << 12):
+        from multiprocessing.shared_memory import SharedMemory
+
+        self.num_slots = num_slots
+        self.slot_size = slot_size
+        self.shm = SharedMemory(create=True, size=num_slots * slot_size)
+        self.free_slots = Semaphore(num_slots)
+        self.ready_slots = Semaphore(0)
+        self.overflow_rpipe, self.overflow_spipe = Pipe(duplex=False)
+
+        # process local states
+        self.send_count = 0
+        self.send_meta = None
+        self.recv_count = 0
+        self.recv_meta = None
+        self.num_ready = 0 # acquired by poll
+        self.num_held = 0 # received, not released
+        self.views = []
+
+    def send(self, item:'Tuple[Any, Any]'):
+        """send (frame, document)"""
+
+        frame, document = item
+        self.free_slots.acquire()
+        offset = (self.send_count % self.num_slots) * self.slot_size
+        self.send_count += 1
+        buf = self.shm.buf
+
+        is_frame = len(getattr(frame, '_fields', ())) == 2 # (name, index)
+        typecode = self.typecode_of(document) if is_frame else ''
+        if typecode:
+            name, index = frame
+            meta = type(frame), name, tuple(document.keys())
+            meta_bytes = b'' if meta == self.send_meta else pickle.dumps(meta)
+            values_offset = (self.HEADER.size + len(meta_bytes) + 7) & ~7
+            if values_offset + len(document) * 8 <= self.slot_size:
+                self.send_meta = meta
+                self.HEADER.pack_into(buf, offset, self.KIND_NUMERIC, typecode.encode(),
+                                      index is None, len(meta_bytes), index or 0, len(document))
+                meta_offset = offset + self.HEADER.size
+                buf[meta_offset:meta_offset + len(meta_bytes)] = meta_bytes
+                struct.pack_into(f'<{len(document)}{typecode}', buf, offset + values_offset,
+                                 *document.values())
+                self.ready_slots.release()
+                return
+
+        meta_bytes = pickle.dumps(item)
+        if self.HEADER.size + len(meta_bytes) <= self.slot_size:
+            self.HEADER.pack_into(buf, offset, self.KIND_PICKLED, b' ', False,
+                                  len(meta_bytes), 0, 0)
+            meta_offset = offset + self.HEADER.size
+            buf[meta_offset:meta_offset + len(meta_bytes)] = meta_bytes
+            self.ready_slots.release()
+        else:
+            self.HEADER.pack_into(buf, offset, self.KIND_OVERFLOW, b' ', False, 0, 0, 0)
+            self.ready_slots.release()
+            self.overflow_spipe.send(item)
+
+    def poll(self, timeout:float=0.)->bool:
+        """whether any item is ready"""
+
+        if self.num_ready == 0 and self.ready_slots.acquire(timeout=timeout):
+            self.num_ready += 1
+        return self.num_ready > 0
+
+    def recv(self)->'Tuple[Any, Any]':
+        """receive (frame, document)"""
+
+        return self.recv_batch(1)[0]
+
+    def recv_batch(self, max_count:int)->'List[Tuple[Any, Any]]':
+        """receive at least one and up to `max_count` items"""
+
+        self.release()
+        max_count = min(max_count, self.num_slots)
+        if self.num_ready == 0:
+            self.ready_slots.acquire()
+            self.num_ready += 1
+        ret = []
+        while True:
+            ret.append(self.read_slot())
+            self.num_ready -= 1
+            if len(ret) >= max_count or not self.poll():
+                break
+        return ret
+
+    def release(self):
+        """release the slots of received items"""
+
+        for view in self.views:
+            view.release()
+        self.views.clear()
+        for _ in range(self.num_held):
+            self.free_slots.release()
+        self.num_held = 0
+
+    def close(self,
+              unlink:bool=False):
+        """close the shared memory, and unlink it if `unlink`"""
+
+        self.release()
+        self.shm.close()
+        if unlink:
+            self.shm.unlink()
+
+    def read_slot(self)->'Tuple[Any, Any]':
+        """read the next slot"""
+
+        offset = (self.recv_count % self.num_slots) * self.slot_size
+        self.recv_count += 1
+        self.num_held += 1
+        buf = self.shm.buf
+
+        kind, typecode, no_index, meta_size, index, num_values = \
+                self.HEADER.unpack_from(buf, offset)
+        if kind == self.KIND_OVERFLOW:
+            return self.overflow_rpipe.recv()
+
+        meta_offset = offset + self.HEADER.size
+        if kind == self.KIND_PICKLED:
+            return pickle.loads(buf[meta_offset:meta_offset + meta_size])
+
+        if meta_size:
+            frame_cls, name, keys = pickle.loads(buf[meta_offset:meta_offset + meta_size])
+            key_index = {key: idx for idx, key in enumerate(keys)}
+            self.recv_meta = frame_cls, name, keys, key_index
+        frame_cls, name, keys, key_index = self.recv_meta
+        values_offset = offset + ((self.HEADER.size + meta_size + 7) & ~7)
+        values = buf[values_offset:values_offset + num_values * 8].cast(typecode.decode())
+        self.views.append(values)
+        frame = frame_cls(name, None if no_index else index)
+        return frame, NumericDocument(keys, key_index, values)
+
+    @staticmethod
+    def is_numeric(document:'Any')->bool:
+        """if `document` is a non-empty flat mapping of int and float values"""
+
+        return isinstance(document, dict) and bool(document) and \
+                set(map(type, document.values())) <= {int, float}
+
+    @staticmethod
+    def typecode_of(document:'Any')->str:
+        """
+        array typecode for a flat numeric mapping of a single value type,
+        '' otherwise, so mixed int and float values are pickled with their types
+        """
+
+        if not isinstance(document, dict) or not document:
+            return ''
+
+        types = set(map(type, document.values()))
+        if types == {int}:
+            in_range = all(-(1 << 63) <= value < (1 << 63) for value in document.values())
+            return 'q' if in_range else ''
+
+        return 'd' if types == {float} else ''
+
+
+class SeriesStore(Mapping):
+    """
+    numeric series of the latest `capacity` documents in frames named `name`(all frames if None),
+    one preallocated ring buffer per flattened key path(e.g. 'pose.x'), as a mapping of
+    key path to read-only ordered view, which is valid until the next extend,
+    a value missing in a document is NaN, a new key path is back-filled with NaN,
+    a key path missing in the whole window is removed, non-numeric values are ignored
+    """
+
+    def __init__(self,
+                 capacity:int=1024,
+                 name:'Optional[str]'=None,
+                 dtype:'Any'='float64'): # HINT: floating for NaN
+        import numpy as np
+
+        self.capacity = capacity
+        self.name = name
+        self.dtype = np.dtype(dtype)
+        self.count = 0 # number of documents ever appended
+        self.buffers = dict()
+        self.last_seen = dict()
+
+        # HINT: each value is written twice, so the window is always a contiguous slice
+        self.index_buffer = np.full(capacity * 2, np.nan)
+
+    def __getitem__(self, key:str)->'numpy.ndarray':
+        return self.view(self.buffers[key])
+
+    def __iter__(self)->'Iterator[str]':
+        return iter(self.buffers)
+
+    def __len__(self)->int:
+        return len(self.buffers)
+
+    @property
+    def size(self)->int:
+        """number of documents in the window"""
+
+        return min(self.count, self.capacity)
+
+    @property
+    def index(self)->'numpy.ndarray':
+        """frame indices of the window, NaN if None"""
+
+        return self.view(self.index_buffer)
+
+    def view(self, buffer:'numpy.ndarray')->'numpy.ndarray':
+        """read-only ordered view of the window in `buffer`"""
+
+        end = self.count % self.capacity + self.capacity
+        ret = buffer[end - self.size:end]
+        ret.flags.writeable = False
+        return ret
+
+    def extend(self, frames:'Iterable[Tuple[Frame, Any]]')->int:
+        """append a batch of (frame, document), return the number of appended documents"""
+
+        import numpy as np
+
+        from columnar import flatten_document
+
+        frames = [(frame, document) for frame, document in frames
+                  if self.name is None or frame.name == self.name]
+        num_frames = len(frames)
+        frames = frames[-self.capacity:]
+        num_rows = len(frames)
+        if num_rows == 0:
+            return 0
+
+        count = self.count + num_frames
+        columns = dict()
+        indices = np.full(num_rows, np.nan)
+        for row, (frame, document) in enumerate(frames):
+            if frame.index is not None:
+                indices[row] = frame.index
+            for key, value in flatten_document(document):
+                if not isinstance(value, (int, float, np.number, np.bool_)):
+                    continue
+
+                column = columns.get(key)
+                if column is None:
+                    column = columns[key] = np.full(num_rows, np.nan, dtype=self.dtype)
+                column[row] = value
+
+        positions = (count - num_rows + np.arange(num_rows)) % self.capacity
+        positions = np.concatenate([positions, positions + self.capacity])
+        self.index_buffer[positions] = np.tile(indices, 2)
+        for key, buffer in self.buffers.items():
+            if key not in columns:
+                buffer[positions] = np.nan
+        for key, column in columns.items():
+            buffer = self.buffers.get(key)
+            if buffer is None:
+                buffer = self.buffers[key] = np.full(self.capacity * 2, np.nan, dtype=self.dtype)
+            buffer[positions] = np.tile(column, 2)
+            self.last_seen[key] = count
+
+        self.count = count
+        for key in [key for key, seen in self.last_seen.items() if seen + self.capacity <= count]:
+            self.buffers.pop(key)
+            self.last_seen.pop(key)
+        return num_frames
+
+    def append(self, frame:'Frame', document:'Any')->bool:
+        """append a document, return False if the frame is not selected"""
+
+        return self.extend([(frame, document)]) > 0
+
+    def clear(self):
+        """remove all series"""
+
+        self.count = 0
+        self.buffers.clear()
+        self.last_seen.clear()
+        self.index_buffer.fill(float('nan'))
+
+
+class FrameCoalescer(object):
+    """
+    documents pending between renders, one per key(e.g. (thread_id, frame name)) in order,
+    mode 'latest': only the latest document of a key is kept,
+    mode 'mean': flat numeric documents(see SharedFrameTransport.is_numeric) of a key with
+    the same keys are averaged into the latest frame, others are kept as 'latest'
+    a pending document may be lazy(e.g. parsers.LazyDocument), superseded ones are never parsed
+    """
+
+    MODES :tuple = ('latest', 'mean')
+
+    def __init__(self,
+                 mode:str='latest'):
+        assert mode in self.MODES, f'unknown coalescing mode {mode!r}'
+
+        self.mode = mode
+        self.pending = dict() # key: [frame, document, sums, count]
+        self.num_dropped = 0
+
+    def __len__(self)->int:
+        return len(self.pending)
+
+    def get(self, key:'Any')->'Any':
+        """the pending document of `key`, None if not pending"""
+
+        entry = self.pending.get(key)
+        return entry and entry[1]
+
+    def push(self, key:'Any', frame:'Frame', document:'Any'):
+        """push (frame, document) of `key`, coalescing the pending one"""
+
+        entry = self.pending.get(key)
+        if entry is not None:
+            self.num_dropped += 1
+
+        if self.mode == 'mean' and SharedFrameTransport.is_numeric(document):
+            sums = entry and entry[2]
+            if sums and sums.keys() == document.keys():
+                for name, value in document.items():
+                    sums[name] += value
+                entry[:] = frame, document, sums, entry[3] + 1
+                return
+
+            self.pending[key] = [frame, document, dict(document), 1]
+            return
+
+        self.pending[key] = [frame, document, None, 1]
+
+    def pop(self)->'List[Tuple[Any, Frame, Any]]':
+        """pop all pending (key, frame, document)"""
+
+        ret = []
+        for key, (frame, document, sums, count) in self.pending.items():
+            if count > 1:
+                document = {name: value / count for name, value in sums.items()}
+            ret.append((key, frame, document))
+        self.pending.clear()
+        return ret
+
+
 class BasicRenderer(object):
     """
 
     implement your create_backend, create_frontend
-    log_path: path to log file or SSH URL
+    log_path: path to log file, SSH URL, or 'shm:<name>' for the shared memory ring of
+              YSL::SharedMemorySink
+    transport: 'pipe' to send data with multiprocessing.Pipe,
+               'shm' to send data with SharedFrameTransport
+    render_rate: frames per second per key advertised by the frontend, frames are sent as
+                 they are parsed if None, otherwise coalesced by `coalesce`, see 'service'
+    coalesce: mode of FrameCoalescer
     """
 
+    BATCH_SIZE :int = 256 # max number of frames rendered in a batch
+
     def __init__(self, log_path:str,
-                 *args, **kwargs):
+                 *args,
+                 transport:str='pipe',
+                 render_rate:'Optional[float]'=None,
+                 coalesce:str='latest',
+                 **kwargs):
         self.logger = logging.getLogger('BasicRenderer')
         self.log_path = log_path
+        self.transport = transport
+        self.shared_transport = None
+        self.render_rate = render_rate
+        self.coalesce = coalesce
 
         self.logger.debug('creating backend and frontend ...')
         self.backend, pipes = self.create_backend(log_path)
@@ -54,6 +459,8 @@ class BasicRenderer(object):
         self.logger.info('exiting ...')
         self.backend.terminate()
         kill_proc(self.backend) # WORKAROUND: for some backends
+        if self.shared_transport:
+            self.shared_transport.close(unlink=True)
 
     def create_backend(self, log_path:str)->'Tuple[Process, Sequence[Pipe]]':
         """
@@ -65,7 +472,11 @@ class BasicRenderer(object):
         """
 
         frontend_cpipe, backend_cpipe = Pipe(duplex=True)
-        data_rpipe, data_spipe = Pipe(duplex=False)
+        if self.transport == 'shm':
+            self.shared_transport = SharedFrameTransport()
+            data_rpipe = data_spipe = self.shared_transport
+        else:
+            data_rpipe, data_spipe = Pipe(duplex=False)
         backend = Process(
                 target=self.service,
                 args=(backend_cpipe, data_spipe, log_path),
@@ -87,10 +498,13 @@ class BasicRenderer(object):
                 self.control_pipe, self.data_pipe = pipes
 
             def run(self):
+                if self.renderer.render_rate:
+                    self.control_pipe.send(('rate', self.renderer.render_rate))
                 while True:
                     try:
-                        self.renderer.render(*self.data_pipe.recv())
-                    except BrokenPipeError:
+                        frames = recv_batch(self.data_pipe, self.renderer.BATCH_SIZE)
+                        self.renderer.render_batch(frames)
+                    except (BrokenPipeError, EOFError):
                         self.renderer.logger.error('backend exited unexpectly')
                         break
                     except BaseException as e:
@@ -105,39 +519,143 @@ class BasicRenderer(object):
         return dummy_frontend
 
     def service(self, control_pipe:Pipe, data_pipe:Pipe, log_path:str):
-        """the default backend service"""
+        """
+        the default backend service
+        control commands:
+            ('rate', rate): frames are coalesced(see FrameCoalescer) per thread and frame name,
+                            and sent at most `rate` times per second,
+                            documents are only parsed once sent, unless in mode 'mean',
+                            or in delta frames(see YSL::DeltaFrames),
+                            coalescing is disabled if `rate` is 0 or None
+            other true value: exit
+        """
+
+        import queue, threading, time, yaml
 
-        from ysl.backends import tailc, ssh_tailc
-        from ysl.constructors import LogLoader
-        from ysl.glog_parser import GlogParser, get_msg
-        from ysl.parsers import frame_parser
+        from ysl.backends import followc, shm_followc, ssh_tailc
+        from ysl.glog_parser import GlogParser
+        from ysl.parsers import DeltaResolver, LazyDocument
+        from ysl.parsers import lazy_frame_parser, lazy_shm_frame_parser
 
         logger = logging.getLogger('service')
         logger.info('create default YSL parser')
 
-        # auto local / remote tailc
-        match = re.fullmatch(r'((\w+@)?.+):(.+)', log_path)
-        if match is None:
-            logger.info('with local file: %s', log_path)
-            proc = tailc(log_path)
+        # shared memory ring of YSL::SharedMemorySink, bypassing the log file and glog prefixes
+        if log_path.startswith('shm:'):
+            logger.info('with shared memory: %s', log_path[4:])
+            lazy_stream = lazy_shm_frame_parser(shm_followc(log_path[4:]))
         else:
-            address, _, log_path = match.groups()
-            logger.info('with SSH remote file: %s', log_path)
-            proc = ssh_tailc(address, log_path)
-
-        glog_parser = GlogParser()
-        record_stream = glog_parser.process(proc.stdout)
-        msg_stream = get_msg(record_stream)
-        frame_stream = frame_parser(msg_stream, yaml_loader_cls=LogLoader, persistent=True)
-
-        for frame in frame_stream:
-            if control_pipe.poll():
-                command = control_pipe.recv()
-                if command: # sample control command
-                    logger.info('got exit command, exiting ...')
+            # auto local follower / remote tailc
+            match = re.fullmatch(r'((\w+@)?.+):(.+)', log_path)
+            if match is None:
+                logger.info('with local file: %s', log_path)
+                text_stream = followc(log_path)
+            else:
+                address, _, log_path = match.groups()
+                logger.info('with SSH remote file: %s', log_path)
+                text_stream = ssh_tailc(address, log_path).stdout
+
+            glog_parser = GlogParser()
+            record_stream = glog_parser.process(text_stream)
+            # HINT: the default loader constructs documents of the same modules as DeltaResolver
+            lazy_stream = lazy_frame_parser(record_stream)
+
+        # HINT: followed in a thread, so pending frames are sent on time as the log is idle
+        lazy_queue = queue.Queue(self.BATCH_SIZE)
+
+        def follow():
+            for lazy_document in lazy_stream:
+                lazy_queue.put(lazy_document)
+            lazy_queue.put(None) # end of stream
+
+        threading.Thread(target=follow, daemon=True).start()
+
+        delta_regex = re.compile(r'^!delta\s', re.MULTILINE)
+        delta_resolver = DeltaResolver()
+        delta_keys = set() # HINT: parsed in order, as the base of following delta documents
+        coalescer = FrameCoalescer(self.coalesce)
+        period = 0.
+        deadline = 0.
+
+        def parse(lazy_document:LazyDocument)->'Optional[Tuple[Frame, Any]]':
+            try:
+                document = lazy_document.document
+            except yaml.YAMLError as e:
+                logger.warn('got exception in thread %d:\n%s\ndocument is dropped',
+                            lazy_document.thread_id, e)
+                return None
+
+            item = (lazy_document.thread_id, lazy_document.frame, document)
+            item = delta_resolver.parse(item)
+            return item and item[1:]
+
+        def push(lazy_document:LazyDocument):
+            key = lazy_document.thread_id, lazy_document.name
+            if delta_regex.search(lazy_document.text):
+                delta_keys.add(key)
+            if key in delta_keys or coalescer.mode == 'mean':
+                pending = coalescer.get(key)
+                if isinstance(pending, LazyDocument):
+                    parse(pending)
+                item = parse(lazy_document)
+                if item is not None:
+                    coalescer.push(key, *item)
+            else:
+                coalescer.push(key, lazy_document.frame, lazy_document)
+
+        def flush():
+            for _, frame, document in coalescer.pop():
+                if isinstance(document, LazyDocument):
+                    item = parse(document)
+                    if item is None:
+                        continue
+
+                    frame, document = item
+                data_pipe.send((frame, document))
+
+        while True:
+            command = control_pipe.recv() if control_pipe.poll() else None
+            if isinstance(command, tuple) and command[0] == 'rate':
+                _, rate = command
+                logger.info('frontend render rate: %s', rate)
+                period = 1. / rate if rate else 0.
+            elif command: # sample control command
+                logger.info('got exit command, exiting ...')
+                break
+
+            timeout = max(deadline - time.monotonic(), 0.) if coalescer else 1.
+            try:
+                lazy_document = lazy_queue.get(timeout=timeout)
+            except queue.Empty:
+                pass
+            else:
+                if lazy_document is None:
+                    flush()
                     break
 
-            data_pipe.send(frame)
+                if not period and not coalescer:
+                    item = parse(lazy_document)
+                    if item is not None:
+                        data_pipe.send(item)
+                    continue
+
+                push(lazy_document)
+
+            now = time.monotonic()
+            if coalescer and now >= deadline:
+                deadline = now + period
+                flush()
+
+        logger.info('%d frames coalesced', coalescer.num_dropped)
+
+    def render_batch(self, frames:'Sequence[Tuple[Frame, Any]]'):
+        """
+        render a batch of (frame, document) drained at once, see 'render',
+        e.g. feed SeriesStore.extend and plot the views once per batch
+        """
+
+        for frame, document in frames:
+            self.render(frame, document)
 
     def render(self, frame:'Frame', document:'Any'):
         """the sample frontend: just print the frame and document"""
@@ -148,5 +666,5 @@ class BasicRenderer(object):
 
 if __name__ == '__main__':
     logging.basicConfig(level=logging.DEBUG)
-    renderer = BasicRenderer('/tmp/test.log')
+    renderer = BasicRenderer('/tmp/test.log', transport='shm')
     renderer.run()